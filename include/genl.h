@@ -2,5 +2,9 @@
 #define __GENL_H
 
 int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *group);
+int genl_resolve_family(struct nl_sock *sock, const char *family);
+
+int genl_ctrl_listen(struct nl_sock *sock);
+int genl_ctrl_event(struct nl_msg *msg, const char *family);
 
 #endif
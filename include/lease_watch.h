@@ -0,0 +1,35 @@
+#ifndef __LEASE_WATCH_H
+#define __LEASE_WATCH_H
+
+#include <stddef.h>
+#include <sys/inotify.h>
+
+#include "station_table.h"
+
+#define DNSMASQ_LEASE_FILE_FORMAT "/var/lib/NetworkManager/dnsmasq-%s.leases"
+
+/*
+ * Follows a dnsmasq lease file with inotify. The directory is watched
+ * rather than the file so that a lease file which does not exist yet, or
+ * which is replaced by a rename, keeps being followed. Several watches can
+ * share one inotify descriptor, lease_watch_read() drains it and
+ * lease_watch_match() tells which watches an event is about.
+ */
+struct lease_watch
+{
+	int wd;
+	char *path;
+	const char *name;
+	/* read buffer, reused across parses */
+	char *buf;
+	size_t size;
+};
+
+int lease_watch_init(struct lease_watch *lw, int fd, const char *path);
+void lease_watch_close(struct lease_watch *lw);
+int lease_watch_read(int fd, void (*handler)(const struct inotify_event *ev, void *arg),
+		     void *arg);
+int lease_watch_match(const struct lease_watch *lw, const struct inotify_event *ev);
+int lease_watch_parse(struct lease_watch *lw, struct station_table *stations);
+
+#endif
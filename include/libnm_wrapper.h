@@ -14,6 +14,7 @@ extern "C" {
 #define LIBNM_DEFAULT_ANONYMOUSE_IDENTITY "summit"
 
 typedef void * libnm_wrapper_handle;
+typedef void * libnm_wrapper_transaction;
 
 typedef struct _NMWrapperDevice {
 	int	autoconnect;
@@ -34,6 +35,49 @@ typedef struct _NMWrapperAccessPoint {
 	char    bssid[LIBNM_WRAPPER_MAX_MAC_ADDR_LEN];
 } NMWrapperAccessPoint;
 
+/**
+ * AP as seen by an access point visitor. ssid points into the AP object and
+ * is only valid during the visitor call, it is not NUL terminated.
+ */
+typedef struct _NMWrapperAccessPointView {
+	const unsigned char *ssid;
+	size_t	ssid_len;
+	unsigned char bssid[LIBNM_WRAPPER_MAX_MAC_ADDR_LEN];
+	unsigned int mode;
+	unsigned int frequency;
+	unsigned int strength;
+	unsigned int flags;
+	unsigned int wpa_flags;
+	unsigned int rsn_flags;
+} NMWrapperAccessPointView;
+
+/**
+ * Access point visitor.
+ * @param ap: current AP
+ * @param user_data: user data passed to the iteration
+ *
+ * Returns: 0 to continue, non-zero to stop the iteration
+ */
+typedef int (*LIBNM_WRAPPER_ACCESS_POINT_VISITOR)(const NMWrapperAccessPointView *ap, void *user_data);
+
+typedef void * libnm_wrapper_scan_delta;
+
+#define LIBNM_WRAPPER_MAX_SSID_LEN	32
+
+#define LIBNM_WRAPPER_AP_ADDED		1
+#define LIBNM_WRAPPER_AP_REMOVED	2
+#define LIBNM_WRAPPER_AP_CHANGED	3
+
+typedef struct _NMWrapperAccessPointDelta {
+	// One of LIBNM_WRAPPER_AP_*
+	unsigned int change;
+	unsigned int frequency;
+	unsigned int strength;
+	unsigned int ssid_len;
+	unsigned char ssid[LIBNM_WRAPPER_MAX_SSID_LEN];
+	unsigned char bssid[LIBNM_WRAPPER_MAX_MAC_ADDR_LEN];
+} NMWrapperAccessPointDelta;
+
 typedef struct _NMWrapperSettings {
 	int		autoconnect;
 	char	type[LIBNM_WRAPPER_MAX_NAME_LEN];
@@ -190,6 +234,22 @@ static inline void NMWrapperWireless8021xSettings_init(NMWrapperWireless8021xSet
 	wxs->private_key_password_none = false;
 }
 
+/**
+ * One profile of a bulk provisioning request.
+ */
+typedef struct _NMWrapperWirelessProfile {
+	NMWrapperSettings *s;
+	NMWrapperWirelessSettings *ws;
+	NMWrapperWirelessSecuritySettings *wss;
+	NMWrapperWireless8021xSettings *wxs;
+	///Set by the library to LIBNM_WRAPPER_ERR_SUCCESS if the profile was added
+	int result;
+} NMWrapperWirelessProfile;
+
+///Add profiles in-memory first and persist them once all are added
+#define LIBNM_WRAPPER_BULK_IN_MEMORY		(1 << 0)
+#define LIBNM_WRAPPER_BULK_DEFAULT_IN_FLIGHT	8
+
 static inline const char* prefix_to_netmask(int prefix, char *buffer, int len)
 {
 	struct in_addr mask;
@@ -213,6 +273,174 @@ typedef struct _NMWrapperIPRoute {
 	char dest[LIBNM_WRAPPER_MAX_NAME_LEN];
 } NMWrapperIPRoute;
 
+#define LIBNM_WRAPPER_SNAPSHOT_VERSION		1
+#define LIBNM_WRAPPER_SNAPSHOT_MAX_ROUTE_NUM	8
+#define LIBNM_WRAPPER_SNAPSHOT_MAX_DNS_NUM	2
+#define LIBNM_WRAPPER_SNAPSHOT_MAX_DHCP_NUM	16
+
+typedef struct _NMWrapperDhcpOption {
+	char name[LIBNM_WRAPPER_MAX_NAME_LEN];
+	char value[LIBNM_WRAPPER_MAX_NAME_LEN];
+} NMWrapperDhcpOption;
+
+typedef struct _NMWrapperInterfaceSnapshot {
+	char	interface[LIBNM_WRAPPER_MAX_NAME_LEN];
+	int	type;
+	int	state_reason;
+	NMWrapperDevice device;
+
+	// Active connection, valid if has_active is set
+	int	has_active;
+	int	active_state;
+	char	active_id[LIBNM_WRAPPER_MAX_NAME_LEN];
+
+	// Active IPv4 configuration, valid if has_ipv4 is set
+	int	has_ipv4;
+	uint32_t ipv4_prefix;
+	char	ipv4_address[LIBNM_WRAPPER_MAX_NAME_LEN];
+	char	ipv4_subnet[LIBNM_WRAPPER_MAX_NAME_LEN];
+	char	ipv4_gateway[LIBNM_WRAPPER_MAX_NAME_LEN];
+	char	ipv4_dns[LIBNM_WRAPPER_SNAPSHOT_MAX_DNS_NUM][LIBNM_WRAPPER_MAX_NAME_LEN];
+	int	route_num;
+	NMWrapperIPRoute routes[LIBNM_WRAPPER_SNAPSHOT_MAX_ROUTE_NUM];
+
+	// DHCPv4 options, in no particular order
+	int	dhcp_option_num;
+	NMWrapperDhcpOption dhcp_options[LIBNM_WRAPPER_SNAPSHOT_MAX_DHCP_NUM];
+
+	// Active AP of wifi devices, valid if has_ap is set
+	int	has_ap;
+	NMWrapperAccessPoint ap;
+} NMWrapperInterfaceSnapshot;
+
+typedef struct _NMWrapperSnapshot {
+	// Set by caller to LIBNM_WRAPPER_SNAPSHOT_VERSION
+	uint32_t version;
+	// Number of entries filled in interfaces[]
+	uint32_t num;
+	// Number of devices matched, may be larger than num
+	uint32_t total;
+	uint32_t pad;
+	NMWrapperInterfaceSnapshot interfaces[];
+} NMWrapperSnapshot;
+
+// Bytes needed for a snapshot holding up to n interfaces
+#define LIBNM_WRAPPER_SNAPSHOT_SIZE(n) \
+	(sizeof(NMWrapperSnapshot) + (n) * sizeof(NMWrapperInterfaceSnapshot))
+
+typedef void * libnm_wrapper_subscription;
+
+#define LIBNM_WRAPPER_EVENT_DEVICE_STATE	(1 << 0)
+#define LIBNM_WRAPPER_EVENT_ACTIVE_STATE	(1 << 1)
+#define LIBNM_WRAPPER_EVENT_IP_CONFIG		(1 << 2)
+#define LIBNM_WRAPPER_EVENT_AP_LIST		(1 << 3)
+#define LIBNM_WRAPPER_EVENT_CONNECTION_ADDED	(1 << 4)
+#define LIBNM_WRAPPER_EVENT_CONNECTION_REMOVED	(1 << 5)
+#define LIBNM_WRAPPER_EVENT_DEVICE_ADDED	(1 << 6)
+#define LIBNM_WRAPPER_EVENT_DEVICE_REMOVED	(1 << 7)
+#define LIBNM_WRAPPER_EVENT_ALL			0xff
+
+typedef struct _NMWrapperEvent {
+	// One of LIBNM_WRAPPER_EVENT_*
+	unsigned int type;
+	// Device or active connection state and reason, for state events
+	int	state;
+	int	reason;
+	// Number of changes merged into this event
+	unsigned int count;
+	char	interface[LIBNM_WRAPPER_MAX_NAME_LEN];
+	// Connection id, for active connection and connection events
+	char	id[LIBNM_WRAPPER_MAX_NAME_LEN];
+} NMWrapperEvent;
+
+typedef void (*LIBNM_WRAPPER_EVENT_CALLBACK)(const NMWrapperEvent *event, void *user_data);
+
+typedef void * libnm_wrapper_cqm;
+
+#define LIBNM_WRAPPER_CQM_MAX_THRESHOLDS	8
+
+#define LIBNM_WRAPPER_CQM_RSSI_LOW		1
+#define LIBNM_WRAPPER_CQM_RSSI_HIGH		2
+#define LIBNM_WRAPPER_CQM_BEACON_LOSS		3
+#define LIBNM_WRAPPER_CQM_PACKET_LOSS		4
+
+typedef struct _NMWrapperCqmEvent {
+	// One of LIBNM_WRAPPER_CQM_*
+	int	type;
+	char	interface[LIBNM_WRAPPER_MAX_NAME_LEN];
+	// RSSI in dBm that triggered the event, 0 if the driver does not report it
+	int	rssi;
+	// Number of lost packets, for packet loss events
+	unsigned int packets;
+} NMWrapperCqmEvent;
+
+typedef void (*LIBNM_WRAPPER_CQM_CALLBACK)(const NMWrapperCqmEvent *event, void *user_data);
+
+// 2.4, 5, 60 and 6 GHz, indexed by enum nl80211_band
+#define LIBNM_WRAPPER_MAX_BANDS		4
+#define LIBNM_WRAPPER_MAX_WIPHY_CHANNELS	128
+
+#define LIBNM_WRAPPER_CHAN_DISABLED		(1 << 0)
+#define LIBNM_WRAPPER_CHAN_NO_IR		(1 << 1)
+#define LIBNM_WRAPPER_CHAN_RADAR		(1 << 2)
+#define LIBNM_WRAPPER_CHAN_NO_HT40_MINUS	(1 << 3)
+#define LIBNM_WRAPPER_CHAN_NO_HT40_PLUS		(1 << 4)
+#define LIBNM_WRAPPER_CHAN_NO_80MHZ		(1 << 5)
+#define LIBNM_WRAPPER_CHAN_NO_160MHZ		(1 << 6)
+#define LIBNM_WRAPPER_CHAN_INDOOR_ONLY		(1 << 7)
+
+typedef struct _NMWrapperWiphyChannel {
+	// MHz
+	uint32_t freq;
+	// LIBNM_WRAPPER_CHAN_* flags
+	uint32_t flags;
+	int	band;
+	// enum nl80211_dfs_state, meaningful for radar channels
+	int	dfs_state;
+	// Maximum transmit power in mBm
+	int	max_power;
+} NMWrapperWiphyChannel;
+
+typedef struct _NMWrapperWiphyBand {
+	bool	present;
+	bool	ht;
+	bool	vht;
+	bool	he;
+	uint16_t ht_capa;
+	uint32_t vht_capa;
+} NMWrapperWiphyBand;
+
+typedef struct _NMWrapperWiphy {
+	int	index;
+	char	name[LIBNM_WRAPPER_MAX_NAME_LEN];
+	NMWrapperWiphyBand bands[LIBNM_WRAPPER_MAX_BANDS];
+	int	num_channels;
+	NMWrapperWiphyChannel channels[LIBNM_WRAPPER_MAX_WIPHY_CHANNELS];
+} NMWrapperWiphy;
+
+#define LIBNM_WRAPPER_MAX_REG_RULES	32
+
+typedef struct _NMWrapperRegRule {
+	// Frequency range and maximum bandwidth in kHz
+	uint32_t start_freq;
+	uint32_t end_freq;
+	uint32_t max_bandwidth;
+	// Maximum EIRP in mBm
+	uint32_t max_eirp;
+	// NL80211_RRF_* flags
+	uint32_t flags;
+} NMWrapperRegRule;
+
+typedef struct _NMWrapperRegulatory {
+	char	alpha2[3];
+	// enum nl80211_dfs_regions
+	int	dfs_region;
+	int	num_rules;
+	NMWrapperRegRule rules[LIBNM_WRAPPER_MAX_REG_RULES];
+} NMWrapperRegulatory;
+
+typedef void (*LIBNM_WRAPPER_REGULATORY_CALLBACK)(const NMWrapperRegulatory *reg, void *user_data);
+
 /**
  * @name library management APIs
  * A handle MUST be initialized before calling any of other APIs, and it MUST
@@ -221,7 +449,7 @@ typedef struct _NMWrapperIPRoute {
 
 /**@{*/
 /**
- * Initialize library handle.
+ * Initialize library handle bound to the thread-default main context.
  *
  * Returns: pointer to library handle
  *          NULL if unsuccessful
@@ -229,11 +457,44 @@ typedef struct _NMWrapperIPRoute {
 libnm_wrapper_handle libnm_wrapper_init(void);
 
 /**
- * Destroy library handle.
+ * Initialize library handle bound to a main context.
+ * Each handle owns its NMClient, so handles bound to different contexts can
+ * be used from different threads in parallel. A handle itself must only be
+ * used from the thread iterating its context.
+ * @param context: main context the NMClient of the handle is bound to,
+ *                 NULL to create a private one
  *
  * Returns: pointer to library handle
+ *          NULL if unsuccessful
+ */
+libnm_wrapper_handle libnm_wrapper_init_with_context(GMainContext *context);
+
+/**
+ * Destroy library handle and release all its resources.
+ * @param hd: library handle
  */
 void libnm_wrapper_destroy(libnm_wrapper_handle hd);
+
+/**
+ * Get a file descriptor to poll the main context of the handle with.
+ * The descriptor becomes readable when libnm_wrapper_dispatch_pending()
+ * has work to do, including expired timers, so the handle can be driven from
+ * an external epoll/poll loop without a GMainLoop.
+ * @param hd: library handle
+ *
+ * Returns: file descriptor, -1 if unsuccessful
+ */
+int libnm_wrapper_get_fd(libnm_wrapper_handle hd);
+
+/**
+ * Dispatch the pending events of the main context of the handle.
+ * Never blocks. Call it whenever the descriptor returned by
+ * libnm_wrapper_get_fd() is readable.
+ * @param hd: library handle
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_dispatch_pending(libnm_wrapper_handle hd);
 /**@}*/
 
 
@@ -303,6 +564,20 @@ int libnm_wrapper_delete_connection(libnm_wrapper_handle hd, char *id);
  */
 int libnm_wrapper_connection_set_autoconnect(libnm_wrapper_handle hd, const char *id, bool autoconnect);
 
+/**
+ * Enable/disable auto-start of a connection asynchronously.
+ * @param hd: library handle
+ * @param id: connection id
+ * @param autoconnect: true or false
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the change is committed
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, callback is not invoked otherwise
+ */
+int libnm_wrapper_connection_set_autoconnect_async(libnm_wrapper_handle hd, const char *id, bool autoconnect,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
 /**
  * Get auto-start status of a connection.
  * @param hd: library handle
@@ -324,6 +599,21 @@ int libnm_wrapper_connection_get_autoconnect(libnm_wrapper_handle hd, const char
  */
 int libnm_wrapper_activate_connection(libnm_wrapper_handle hd, const char *interface, char *id, bool wifi);
 
+/**
+ * Activate the connection on the interface asynchronously.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param id: connection id
+ * @param wifi: whether is a wifi connection
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the activation request completes
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, callback is not invoked otherwise
+ */
+int libnm_wrapper_activate_connection_async(libnm_wrapper_handle hd, const char *interface, char *id, bool wifi,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
 /**
  * Deactivate the connection on the interface.
  * @param hd: library handle
@@ -332,6 +622,20 @@ int libnm_wrapper_activate_connection(libnm_wrapper_handle hd, const char *inter
  * Returns: SDCERR_SUCCESS if successful
  */
 int libnm_wrapper_deactivate_connection(libnm_wrapper_handle hd, const char *interface);
+
+/**
+ * Deactivate the connection on the interface asynchronously.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the connection is deactivated,
+ *                  immediately if there is no active connection
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, callback is not invoked otherwise
+ */
+int libnm_wrapper_deactivate_connection_async(libnm_wrapper_handle hd, const char *interface,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
 /**@}*/
 
 /**
@@ -373,6 +677,42 @@ int libnm_wrapper_connection_get_wireless_security_settings(libnm_wrapper_handle
  */
 int libnm_wrapper_connection_add_wireless_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs);
 
+/**
+ * Create a wifi connection profile asynchronously.
+ * @param hd: library handle
+ * @param s: location to store general settings
+ * @param ws: location to store wifi settings
+ * @param wss: location to store wifi security settings
+ * @param wxs: location to store 8021x settings
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once NetworkManager has added the profile
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, callback is not invoked otherwise
+ */
+int libnm_wrapper_connection_add_wireless_connection_async(libnm_wrapper_handle hd, NMWrapperSettings *s,
+	NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Create many wifi connection profiles with a bounded number of requests in flight.
+ * @param hd: library handle
+ * @param profiles: profiles to add, the result of each one is stored in its result field
+ * @param num: number of profiles
+ * @param max_in_flight: maximum number of outstanding requests,
+ *                       LIBNM_WRAPPER_BULK_DEFAULT_IN_FLIGHT if not positive
+ * @param flags: LIBNM_WRAPPER_BULK_IN_MEMORY to add all profiles in-memory
+ *               first and persist them afterwards, a profile that fails to
+ *               be persisted is deleted again
+ *
+ * A profile whose id is already used, by an existing connection or by an
+ * earlier profile of the same batch, fails with LIBNM_WRAPPER_ERR_INVALID_PARAMETER.
+ *
+ * Returns: number of profiles successfully added
+ */
+int libnm_wrapper_connection_add_wireless_connections(libnm_wrapper_handle hd,
+	NMWrapperWirelessProfile *profiles, int num, int max_in_flight, unsigned int flags);
+
 /**
  * Update a wifi connection profile.
  * @param hd: library handle
@@ -385,6 +725,81 @@ int libnm_wrapper_connection_add_wireless_connection(libnm_wrapper_handle hd, NM
  * Returns: SDCERR_SUCCESS if successful
  */
 int libnm_wrapper_connection_update_wireless_connection(libnm_wrapper_handle hd, const char *id, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs);
+
+/**
+ * Update a wifi connection profile asynchronously.
+ * @param hd: library handle
+ * @param id: id of the connection to be updated
+ * @param s: location to store general settings
+ * @param ws: location to store wifi settings
+ * @param wss: location to store wifi security settings
+ * @param wxs: location to store 8021x settings
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the change is committed
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, callback is not invoked otherwise
+ */
+int libnm_wrapper_connection_update_wireless_connection_async(libnm_wrapper_handle hd, const char *id,
+	NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss,
+	NMWrapperWireless8021xSettings *wxs, GMainContext *context,
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+/**@}*/
+
+/**
+ * @name Connection transaction API
+ * Stage changes to several settings of a connection and commit them with a
+ * single D-Bus round trip. Staging errors are sticky: commit reports the
+ * first one and leaves the connection untouched. Commit and abort release
+ * the transaction.
+ */
+/**@{*/
+/**
+ * Begin a transaction on a connection.
+ * @param hd: library handle
+ * @param id: connection id
+ *
+ * Returns: transaction handle, NULL if the connection does not exist
+ */
+libnm_wrapper_transaction libnm_wrapper_transaction_begin(libnm_wrapper_handle hd, const char *id);
+
+int libnm_wrapper_transaction_stage_settings(libnm_wrapper_transaction tr, NMWrapperSettings *s);
+int libnm_wrapper_transaction_stage_autoconnect(libnm_wrapper_transaction tr, bool autoconnect);
+int libnm_wrapper_transaction_stage_wireless_settings(libnm_wrapper_transaction tr, NMWrapperWirelessSettings *ws);
+int libnm_wrapper_transaction_stage_wireless_security_settings(libnm_wrapper_transaction tr, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs);
+int libnm_wrapper_transaction_stage_ipv4_method(libnm_wrapper_transaction tr, const char *value);
+int libnm_wrapper_transaction_stage_ipv4_address(libnm_wrapper_transaction tr, const int index, const char *address, const char *netmask, const char *gateway);
+int libnm_wrapper_transaction_stage_ipv4_dns(libnm_wrapper_transaction tr, const char *address);
+int libnm_wrapper_transaction_stage_ipv6_method(libnm_wrapper_transaction tr, const char *value);
+int libnm_wrapper_transaction_stage_ipv6_address(libnm_wrapper_transaction tr, const int index, const char *address, const char *netmask, const char *gateway);
+int libnm_wrapper_transaction_stage_ipv6_dns(libnm_wrapper_transaction tr, const char *address);
+
+/**
+ * Commit all staged changes and release the transaction.
+ * @param tr: transaction handle
+ *
+ * Returns: SDCERR_SUCCESS if successful, otherwise the first staging error or the commit error
+ */
+int libnm_wrapper_transaction_commit(libnm_wrapper_transaction tr);
+
+/**
+ * Commit all staged changes asynchronously and release the transaction.
+ * @param tr: transaction handle
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the changes are committed
+ * @param user_data: passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started, otherwise the first staging
+ *          error, and callback is not invoked
+ */
+int libnm_wrapper_transaction_commit_async(libnm_wrapper_transaction tr, GMainContext *context,
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Drop all staged changes and release the transaction.
+ * @param tr: transaction handle
+ */
+void libnm_wrapper_transaction_abort(libnm_wrapper_transaction tr);
 /**@}*/
 
 /**
@@ -439,6 +854,91 @@ int libnm_wrapper_connection_get_wired_settings(libnm_wrapper_handle hd, const c
  */
 int libnm_wrapper_access_point_get_scanlist(libnm_wrapper_handle hd, const char *interface, NMWrapperAccessPoint *list, int size);
 
+/**
+ * Visit the AP list without copying it.
+ * No memory is allocated per AP.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param visitor: called for each AP in turn, NULL to only count them
+ * @param user_data: user data passed to visitor
+ * @param total: location to store the number of APs in the list, may be NULL
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_access_point_foreach(libnm_wrapper_handle hd, const char *interface,
+	LIBNM_WRAPPER_ACCESS_POINT_VISITOR visitor, void *user_data, int *total);
+
+/**
+ * Start tracking changes of the AP list of a wifi device.
+ * @param hd: library handle
+ * @param interface: on which interface
+ *
+ * Returns: delta tracker, NULL if unsuccessful
+ */
+libnm_wrapper_scan_delta libnm_wrapper_scan_delta_new(libnm_wrapper_handle hd, const char *interface);
+
+/**
+ * Get the APs added, removed or whose strength changed since a generation.
+ * Changes are reported oldest first, an AP changed several times is
+ * reported once. The cost is proportional to the number of changes.
+ * @param delta: delta tracker
+ * @param generation: generation the caller is at, 0 for the full list. It is
+ *                    updated to the generation of the last change returned,
+ *                    call again while the return value equals size
+ * @param changes: location to store changes
+ * @param size: size of changes
+ *
+ * Returns: number of changes stored, or -1 if the generation is too old to
+ *          compute the changes, in which case the caller should drop its list
+ *          and start over from generation 0
+ */
+int libnm_wrapper_scan_delta_get(libnm_wrapper_scan_delta delta, unsigned long long *generation,
+	NMWrapperAccessPointDelta *changes, int size);
+
+/**
+ * Request a scan and wait for its results asynchronously.
+ * The operation completes when the AP list of the device is updated, or fails
+ * if the request is rejected or no results arrive within 15 seconds.
+ * Restricting frequencies needs a NetworkManager supporting the
+ * "frequencies" scan option, the library must then be configured with
+ * --enable-scan-frequencies. Otherwise a frequency list fails the request
+ * with SDCERR_NOT_IMPLEMENTED rather than scanning all channels.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param ssids: SSIDs to probe for, NULL for a broadcast probe
+ * @param num_ssids: number of ssids
+ * @param frequency_list: frequencies to scan, same format as
+ *                        NMWrapperWirelessSettings.frequency_list, NULL or
+ *                        empty for all
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: completion callback
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the scan was requested
+ */
+int libnm_wrapper_access_point_scan_async(libnm_wrapper_handle hd, const char *interface,
+	const char **ssids, int num_ssids, const char *frequency_list,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Request a scan and wait for its results.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param ssids: SSIDs to probe for, NULL for a broadcast probe
+ * @param num_ssids: number of ssids
+ * @param frequency_list: frequencies to scan, NULL or empty for all
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_access_point_scan(libnm_wrapper_handle hd, const char *interface,
+	const char **ssids, int num_ssids, const char *frequency_list);
+
+/**
+ * Stop tracking changes and release the tracker.
+ * @param delta: delta tracker
+ */
+void libnm_wrapper_scan_delta_free(libnm_wrapper_scan_delta delta);
+
 /**
  * Get active AP settings.
  * @param hd: library handle
@@ -500,6 +1000,94 @@ int libnm_wrapper_device_disconnect(libnm_wrapper_handle hd, const char *interfa
  */
 int libnm_wrapper_device_enable_wireless(libnm_wrapper_handle hd , bool enable);
 
+/**
+ * Enables or disables wireless devices asynchronously.
+ * The operation completes when NetworkManager reports the new state, or fails
+ * after a deadline of 10 seconds.
+ * @param hd: library handle
+ * @param enable: whether to enable wireless
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: completion callback
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_wireless_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Enables or disables WWAN devices.
+ * @param hd: library handle
+ * @param enable: whether to enable WWAN
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_enable_wwan(libnm_wrapper_handle hd, bool enable);
+
+/**
+ * Enables or disables WWAN devices asynchronously.
+ * Completes like libnm_wrapper_device_enable_wireless_async().
+ * @param hd: library handle
+ * @param enable: whether to enable WWAN
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: completion callback
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_wwan_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Enables or disables networking.
+ * @param hd: library handle
+ * @param enable: whether to enable networking
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_enable_networking(libnm_wrapper_handle hd, bool enable);
+
+/**
+ * Enables or disables networking asynchronously.
+ * Completes like libnm_wrapper_device_enable_wireless_async().
+ * The request blocks until NetworkManager replies if the library is built
+ * against NetworkManager older than 1.24.
+ * @param hd: library handle
+ * @param enable: whether to enable networking
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: completion callback
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_networking_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
+/**
+ * Set whether a device is managed by NetworkManager.
+ * @param hd: library handle
+ * @param interface: which device
+ * @param managed: whether the device is managed
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_set_managed(libnm_wrapper_handle hd, const char *interface, bool managed);
+
+/**
+ * Set whether a device is managed by NetworkManager asynchronously.
+ * Completes like libnm_wrapper_device_enable_wireless_async().
+ * @param hd: library handle
+ * @param interface: which device
+ * @param managed: whether the device is managed
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: completion callback
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_set_managed_async(libnm_wrapper_handle hd, const char *interface, bool managed,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data);
+
 /**
  * Determines whether wireless devices are enabled
  * @param hd: library handle
@@ -604,6 +1192,205 @@ int libnm_wrapper_ipv6_disable_nat(libnm_wrapper_handle hd , const char *id);
 int libnm_wrapper_ipv6_enable_nat(libnm_wrapper_handle hd , const char *id);
 /**@}*/
 
+/**
+ * @name Event Subscription API
+ * Events are collected while the main context of the handle is iterated.
+ * Destroying the handle stops the delivery, the subscriptions must still be
+ * cancelled.
+ */
+/**@{*/
+
+/**
+ * Subscribe to changes of devices and connections.
+ * @param hd: library handle
+ * @param mask: LIBNM_WRAPPER_EVENT_* to deliver
+ * @param interface: only deliver events of this interface, NULL for all.
+ *                   Events without an interface, such as changes of profiles
+ *                   not bound to one, are not delivered when set
+ * @param coalesce_ms: delay delivery so changes of the same kind on the same
+ *                     object within this period are merged, 0 to deliver at once
+ * @param callback: called for every event, NULL to queue events for
+ *                  libnm_wrapper_event_read() instead
+ * @param user_data: user data passed to callback
+ *
+ * Returns: subscription, NULL if unsuccessful
+ */
+libnm_wrapper_subscription libnm_wrapper_event_subscribe(libnm_wrapper_handle hd, unsigned int mask,
+	const char *interface, unsigned int coalesce_ms, LIBNM_WRAPPER_EVENT_CALLBACK callback, void *user_data);
+
+/**
+ * Get the file descriptor of a queued subscription.
+ * The descriptor becomes readable when events are ready to be read.
+ * @param sub: subscription created without callback
+ *
+ * Returns: file descriptor, -1 if the subscription delivers through a callback
+ */
+int libnm_wrapper_event_get_fd(libnm_wrapper_subscription sub);
+
+/**
+ * Read queued events.
+ * Pending changes of the same kind on the same object are merged until read.
+ * @param sub: subscription created without callback
+ * @param events: location to store events
+ * @param size: size of events
+ *
+ * Returns: number of events stored
+ */
+int libnm_wrapper_event_read(libnm_wrapper_subscription sub, NMWrapperEvent *events, int size);
+
+/**
+ * Cancel a subscription, also after the handle it was created on is
+ * destroyed.
+ * @param sub: subscription
+ */
+void libnm_wrapper_event_unsubscribe(libnm_wrapper_subscription sub);
+/**@}*/
+
+/**
+ * @name Snapshot API
+ */
+/**@{*/
+
+/**
+ * Get device, active connection, IPv4, route, DHCP and active AP state in
+ * one call. All data is taken from the same state of the client, so the
+ * result is consistent.
+ * @param hd: library handle
+ * @param interface: which device, NULL for all devices
+ * @param snapshot: buffer of LIBNM_WRAPPER_SNAPSHOT_SIZE(size) bytes, with
+ *                  version set to LIBNM_WRAPPER_SNAPSHOT_VERSION
+ * @param size: number of interface entries the buffer holds
+ *
+ * Returns: SDCERR_SUCCESS if successful, the number of entries filled and
+ *          the number of matched devices are stored in snapshot
+ */
+int libnm_wrapper_get_snapshot(libnm_wrapper_handle hd, const char *interface, NMWrapperSnapshot *snapshot, int size);
+/**@}*/
+
+/**
+ * @name Connection Quality Monitor API
+ * The signal of the current link is watched by the driver through nl80211
+ * CQM thresholds, crossings are delivered while the main context of the
+ * handle is iterated. A monitor does not depend on the handle and stays
+ * valid until it is stopped.
+ */
+/**@{*/
+
+/**
+ * Monitor the signal of the link of a client interface.
+ * @param hd: library handle
+ * @param interface: wifi interface name
+ * @param thresholds: RSSI thresholds in dBm, drivers without multiple
+ *                    threshold support only accept one
+ * @param num_thresholds: number of thresholds, 1 to LIBNM_WRAPPER_CQM_MAX_THRESHOLDS
+ * @param hysteresis: hysteresis in dB around a single threshold
+ * @param callback: called for every threshold crossing and every beacon or
+ *                  packet loss event
+ * @param user_data: user data passed to callback
+ *
+ * Returns: monitor, NULL if unsuccessful
+ */
+libnm_wrapper_cqm libnm_wrapper_cqm_start(libnm_wrapper_handle hd, const char *interface,
+	const int *thresholds, int num_thresholds, unsigned int hysteresis,
+	LIBNM_WRAPPER_CQM_CALLBACK callback, void *user_data);
+
+/**
+ * Stop a monitor and clear the thresholds of its interface.
+ * May be called from the callback.
+ * @param cqm: monitor
+ */
+void libnm_wrapper_cqm_stop(libnm_wrapper_cqm cqm);
+/**@}*/
+
+/**
+ * @name Radio Capability API
+ * The capabilities of the radios are read through nl80211 on first use and
+ * followed while the main context of the handle is iterated.
+ */
+/**@{*/
+
+/**
+ * Get the capabilities of the radio of an interface: its bands, HT/VHT/HE
+ * support, and its channels with their flags and DFS state under the
+ * current regulatory domain.
+ * @param hd: library handle
+ * @param interface: wifi interface name
+ * @param wiphy: location to store the capabilities
+ *
+ * Returns: SDCERR_SUCCESS if successful, fails if interface is not a wifi
+ *          interface
+ */
+int libnm_wrapper_wiphy_get(libnm_wrapper_handle hd, const char *interface, NMWrapperWiphy *wiphy);
+/**@}*/
+
+/**
+ * @name Regulatory API
+ * The rules of the regulatory domain and the radios are followed through
+ * nl80211. On every change the frequency_list of each wifi profile is pruned
+ * to the channels that are allowed and that the radio can use, and scans
+ * only request such channels.
+ */
+/**@{*/
+
+/**
+ * Start following the regulatory domain.
+ * @param hd: library handle
+ * @param callback: called on the handle's context after every change of the
+ *                  domain or of the radios, with the pruned frequency lists
+ *                  already recomputed, may be NULL
+ * @param user_data: user data passed to callback
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_watch(libnm_wrapper_handle hd,
+	LIBNM_WRAPPER_REGULATORY_CALLBACK callback, void *user_data);
+
+/**
+ * Stop following the regulatory domain.
+ * @param hd: library handle
+ */
+void libnm_wrapper_regulatory_unwatch(libnm_wrapper_handle hd);
+
+/**
+ * Get the cached rules of the current regulatory domain.
+ * @param hd: library handle
+ * @param reg: location to store the rules
+ *
+ * Returns: SDCERR_SUCCESS if successful, SDCERR_FAIL if the domain is not
+ *          followed
+ */
+int libnm_wrapper_regulatory_get(libnm_wrapper_handle hd, NMWrapperRegulatory *reg);
+
+/**
+ * Get the frequency_list of a wifi profile pruned to the channels of the
+ * current regulatory domain that its radio can use, any radio when the
+ * profile is not bound to an interface.
+ * @param hd: library handle
+ * @param id: connection profile id
+ * @param frequency_list: location to store the pruned list, empty if the
+ *                        profile has no frequency_list
+ * @param size: size of frequency_list
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_get_frequency_list(libnm_wrapper_handle hd, const char *id,
+	char *frequency_list, int size);
+
+/**
+ * Prune a frequency list to the channels of the current regulatory domain
+ * that any radio can use.
+ * @param hd: library handle
+ * @param frequency_list: frequencies in MHz, same format as
+ *                        NMWrapperWirelessSettings.frequency_list
+ * @param pruned: location to store the allowed frequencies
+ * @param size: size of pruned
+ *
+ * Returns: SDCERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_prune_frequency_list(libnm_wrapper_handle hd,
+	const char *frequency_list, char *pruned, int size);
+/**@}*/
+
 /**
  * @name Misc API
  */
@@ -38,6 +38,13 @@ typedef struct _LIBNM_WRAPPER_STATE_MONITOR_CALLBACK_ST
 	void *arg;
 } LIBNM_WRAPPER_STATE_MONITOR_CALLBACK_ST;
 
+/**
+ * Completion callback of async APIs.
+ * @param result: LIBNM_WRAPPER_ERR_SUCCESS if the operation succeeded
+ * @param user_data: user data passed to the async API
+ */
+typedef void (*LIBNM_WRAPPER_ASYNC_CALLBACK)(int result, void *user_data);
+
 static inline void safe_strncpy(char *dest, const char *src, size_t n)
 {
 	size_t m;
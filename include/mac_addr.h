@@ -0,0 +1,66 @@
+#ifndef __MAC_ADDR_H
+#define __MAC_ADDR_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef ETH_ALEN
+#define ETH_ALEN 6
+#endif
+
+#define MAC_ADDRESS_BUFFER_LEN (ETH_ALEN * 3) //xx:xx:xx:xx:xx:xx + '\0'
+
+/* Pack a binary MAC address into the low 48 bits of an integer key */
+static inline uint64_t mac_addr_pack(const unsigned char *addr)
+{
+	uint64_t key = 0;
+	int i;
+
+	for (i = 0; i < ETH_ALEN; i++)
+		key = (key << 8) | addr[i];
+	return key;
+}
+
+/* Format a MAC address, buf must hold MAC_ADDRESS_BUFFER_LEN bytes */
+static inline void mac_addr_n2a(char *buf, const unsigned char *addr)
+{
+	static const char hex[] = "0123456789abcdef";
+	int i;
+
+	for (i = 0; i < ETH_ALEN; i++) {
+		*buf++ = hex[addr[i] >> 4];
+		*buf++ = hex[addr[i] & 0xf];
+		*buf++ = ':';
+	}
+	buf[-1] = '\0';
+}
+
+/*
+ * Parse "xx:xx:xx:xx:xx:xx" of len bytes, the string needs not be
+ * terminated. Returns 0 on success, -1 otherwise.
+ */
+static inline int mac_addr_a2n(unsigned char *addr, const char *str, size_t len)
+{
+	static const signed char nibble[256] = {
+		['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+		['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+		['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+		['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	};
+	int i, hi, lo;
+
+	if (len != MAC_ADDRESS_BUFFER_LEN - 1)
+		return -1;
+
+	for (i = 0; i < ETH_ALEN; i++, str += 3) {
+		/* table entries are the nibble value plus one, 0 is invalid */
+		hi = nibble[(unsigned char)str[0]] - 1;
+		lo = nibble[(unsigned char)str[1]] - 1;
+		if (hi < 0 || lo < 0 || (i < ETH_ALEN - 1 && str[2] != ':'))
+			return -1;
+		addr[i] = (hi << 4) | lo;
+	}
+	return 0;
+}
+
+#endif
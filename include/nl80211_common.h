@@ -0,0 +1,34 @@
+#ifndef __NL80211_COMMON_H
+#define __NL80211_COMMON_H
+
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#ifndef ETH_ALEN
+#define ETH_ALEN 6
+#endif
+
+struct nl80211_state
+{
+	struct nl_sock *nl_sock;
+	int nl80211_id;
+};
+
+int nl80211_init(struct nl80211_state *nlstate);
+void nl80211_cleanup(struct nl80211_state *nlstate);
+int nl80211_set_buffer_size(struct nl80211_state *nlstate, int rxbuf, int txbuf);
+
+struct nl_cb *nl80211_event_cb_alloc(struct nl80211_state *nlstate,
+				     int (*handler)(struct nl_msg *, void *), void *arg);
+int nl80211_event_drain(struct nl80211_state *nlstate, struct nl_cb *cb);
+
+struct nl_msg *nl80211_msg_alloc(struct nl80211_state *nlstate, int cmd, int flags);
+int nl80211_send_and_recv(struct nl80211_state *nlstate, struct nl_msg *msg,
+			  int (*valid_handler)(struct nl_msg *, void *),
+			  void *valid_data);
+int nl80211_parse(struct nl_msg *msg, struct nlattr **tb);
+unsigned int nl80211_get_u32(struct nlattr *attr);
+unsigned int nl80211_parse_bitrate(struct nlattr *attr);
+
+#endif
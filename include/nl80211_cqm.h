@@ -0,0 +1,49 @@
+#ifndef __NL80211_CQM_H
+#define __NL80211_CQM_H
+
+#include "nl80211_common.h"
+
+#define NL80211_CQM_MAX_THRESHOLDS 8
+
+#define NL80211_CQM_EVENT_RSSI_LOW	1
+#define NL80211_CQM_EVENT_RSSI_HIGH	2
+#define NL80211_CQM_EVENT_BEACON_LOSS	3
+#define NL80211_CQM_EVENT_PACKET_LOSS	4
+
+struct nl80211_cqm_event
+{
+	int type;
+	int ifindex;
+	/* RSSI that triggered the event, 0 if the driver does not report it */
+	int rssi;
+	/* Number of lost packets of a packet loss event */
+	unsigned int packets;
+};
+
+typedef void (*nl80211_cqm_callback)(const struct nl80211_cqm_event *event, void *user_data);
+
+/*
+ * Connection quality monitor of one interface. Notifications arrive on a
+ * socket of its own, which the caller polls with the descriptor from
+ * nl80211_cqm_monitor_get_fd() and processes with
+ * nl80211_cqm_monitor_dispatch().
+ */
+struct nl80211_cqm_monitor
+{
+	struct nl80211_state nlstate;
+	struct nl_cb *cb;
+	int ifindex;
+	nl80211_cqm_callback callback;
+	void *user_data;
+};
+
+int nl80211_cqm_set_rssi(struct nl80211_state *nlstate, int ifindex,
+			 const int *thresholds, int n_thresholds, unsigned int hysteresis);
+
+int nl80211_cqm_monitor_init(struct nl80211_cqm_monitor *mon, int ifindex,
+			     nl80211_cqm_callback callback, void *user_data);
+void nl80211_cqm_monitor_close(struct nl80211_cqm_monitor *mon);
+int nl80211_cqm_monitor_get_fd(struct nl80211_cqm_monitor *mon);
+int nl80211_cqm_monitor_dispatch(struct nl80211_cqm_monitor *mon);
+
+#endif
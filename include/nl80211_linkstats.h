@@ -0,0 +1,101 @@
+#ifndef __NL80211_LINKSTATS_H
+#define __NL80211_LINKSTATS_H
+
+#include "nl80211_common.h"
+
+#define NL80211_LINKSTATS_RING_SIZE 32
+#define NL80211_LINKSTATS_DEFAULT_WEIGHT 25
+
+/* Station counters of the associated BSS as reported */
+struct nl80211_linkstats_counters
+{
+	unsigned long long rx_bytes;
+	unsigned long long tx_bytes;
+	/* Set when the driver only reported the 32 bit byte counter */
+	int rx_bytes32;
+	int tx_bytes32;
+	unsigned int rx_packets;
+	unsigned int tx_packets;
+	unsigned int tx_retries;
+	unsigned int tx_failed;
+	unsigned int beacon_loss;
+	unsigned int connected_time;
+	/* Bitrates in units of 100 kbit/s */
+	unsigned int tx_bitrate;
+	unsigned int rx_bitrate;
+	int signal;
+	int signal_avg;
+};
+
+/* Counter increments between two consecutive samples */
+struct nl80211_linkstats_delta
+{
+	unsigned int interval_ms;
+	unsigned long long rx_bytes;
+	unsigned long long tx_bytes;
+	unsigned int rx_packets;
+	unsigned int tx_packets;
+	unsigned int tx_retries;
+	unsigned int tx_failed;
+	unsigned int beacon_loss;
+	unsigned int tx_bitrate;
+	unsigned int rx_bitrate;
+	int signal_avg;
+};
+
+/* Per-second rates, retries per transmitted packet and link state */
+struct nl80211_linkstats_rates
+{
+	double rx_bytes;
+	double tx_bytes;
+	double rx_packets;
+	double tx_packets;
+	double tx_retries;
+	double tx_failed;
+	double beacon_loss;
+	double retry_ratio;
+	/* kbit/s */
+	double tx_bitrate;
+	double rx_bitrate;
+	double signal_avg;
+};
+
+/*
+ * Link statistics sampler of one client interface. The caller polls the
+ * timerfd from nl80211_linkstats_get_fd() and takes the samples with
+ * nl80211_linkstats_dispatch(), or calls nl80211_linkstats_sample() on a
+ * cadence of its own.
+ */
+struct nl80211_linkstats
+{
+	int ifindex;
+	int tfd;
+	int associated;
+	unsigned char bssid[ETH_ALEN];
+	struct nl80211_linkstats_counters last;
+	unsigned long long last_ms;
+	int has_last;
+	/* Most recent deltas, head is the next slot to be written */
+	struct nl80211_linkstats_delta ring[NL80211_LINKSTATS_RING_SIZE];
+	int head;
+	int count;
+	/* Percentage of the newest sample in the moving averages */
+	int weight;
+	struct nl80211_linkstats_rates ewma;
+	int has_ewma;
+};
+
+int nl80211_linkstats_get(struct nl80211_state *nlstate, int ifindex,
+			  const unsigned char *bssid,
+			  struct nl80211_linkstats_counters *counters);
+
+int nl80211_linkstats_init(struct nl80211_linkstats *ls, int ifindex,
+			   int interval_ms, int weight);
+void nl80211_linkstats_close(struct nl80211_linkstats *ls);
+int nl80211_linkstats_get_fd(struct nl80211_linkstats *ls);
+int nl80211_linkstats_dispatch(struct nl80211_state *nlstate, struct nl80211_linkstats *ls);
+int nl80211_linkstats_sample(struct nl80211_state *nlstate, struct nl80211_linkstats *ls);
+int nl80211_linkstats_rates(const struct nl80211_linkstats *ls, int window,
+			    struct nl80211_linkstats_rates *rates);
+
+#endif
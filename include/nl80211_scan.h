@@ -0,0 +1,43 @@
+#ifndef __NL80211_SCAN_H
+#define __NL80211_SCAN_H
+
+#include "nl80211_common.h"
+
+#define NL80211_SCAN_MAX_SSID_LEN	32
+#define NL80211_SCAN_TIMEOUT_MS		10000
+
+/* One BSS of a scan dump, fixed size so results can live in a flat array */
+struct nl80211_scan_bss
+{
+	unsigned char bssid[ETH_ALEN];
+	unsigned char ssid_len;
+	unsigned char associated;
+	unsigned int freq;
+	int signal_mbm;
+	unsigned int seen_ms_ago;
+	unsigned short capability;
+	unsigned short beacon_interval;
+	unsigned char ssid[NL80211_SCAN_MAX_SSID_LEN];
+};
+
+struct nl80211_scan_params
+{
+	/* Frequencies in MHz to scan, all supported ones if n_freqs is 0 */
+	const unsigned int *freqs;
+	int n_freqs;
+	/* SSIDs to probe for, a wildcard probe is sent if n_ssids is 0 */
+	const char **ssids;
+	int n_ssids;
+	/* Only listen, do not send probe requests */
+	int passive;
+};
+
+int nl80211_scan_trigger(struct nl80211_state *nlstate, int ifindex,
+			 const struct nl80211_scan_params *params);
+int nl80211_scan_dump(struct nl80211_state *nlstate, int ifindex,
+		      struct nl80211_scan_bss *bss, int size, int *total);
+int nl80211_scan(struct nl80211_state *nlstate, int ifindex,
+		 const struct nl80211_scan_params *params, int timeout_ms,
+		 struct nl80211_scan_bss *bss, int size, int *total);
+
+#endif
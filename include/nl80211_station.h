@@ -0,0 +1,33 @@
+#ifndef __NL80211_STATION_H
+#define __NL80211_STATION_H
+
+#include "nl80211_common.h"
+
+/*
+ * Per-station statistics of one interface, stored as a structure of arrays
+ * so a sampling pass touches only the columns it needs.
+ */
+struct nl80211_station_table
+{
+	int num;
+	int size;
+	unsigned char (*mac)[ETH_ALEN];
+	signed char *signal;
+	unsigned int *inactive_ms;
+	unsigned long long *rx_bytes;
+	unsigned long long *tx_bytes;
+	unsigned int *rx_packets;
+	unsigned int *tx_packets;
+	unsigned int *tx_retries;
+	unsigned int *tx_failed;
+	/* Bitrates in units of 100 kbit/s */
+	unsigned int *tx_bitrate;
+	unsigned int *rx_bitrate;
+};
+
+int nl80211_station_table_init(struct nl80211_station_table *table, int size);
+void nl80211_station_table_free(struct nl80211_station_table *table);
+int nl80211_station_dump(struct nl80211_state *nlstate, int ifindex,
+			 struct nl80211_station_table *table);
+
+#endif
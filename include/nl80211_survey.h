@@ -0,0 +1,59 @@
+#ifndef __NL80211_SURVEY_H
+#define __NL80211_SURVEY_H
+
+#include "nl80211_common.h"
+
+#define NL80211_SURVEY_MAX_CHANNELS 64
+#define NL80211_SURVEY_RING_SIZE 16
+
+/* Survey counters of one frequency as reported, times are in ms */
+struct nl80211_survey_counters
+{
+	unsigned int freq;
+	int noise;
+	int in_use;
+	unsigned long long time;
+	unsigned long long time_busy;
+	unsigned long long time_rx;
+	unsigned long long time_tx;
+};
+
+/* Counter increments between two consecutive samples */
+struct nl80211_survey_delta
+{
+	unsigned long long time;
+	unsigned long long time_busy;
+	unsigned long long time_rx;
+	unsigned long long time_tx;
+	int noise;
+};
+
+struct nl80211_survey_channel
+{
+	unsigned int freq;
+	int in_use;
+	struct nl80211_survey_counters last;
+	int has_last;
+	/* Most recent deltas, head is the next slot to be written */
+	struct nl80211_survey_delta ring[NL80211_SURVEY_RING_SIZE];
+	int head;
+	int count;
+};
+
+struct nl80211_survey
+{
+	int ifindex;
+	int n_channels;
+	struct nl80211_survey_channel channels[NL80211_SURVEY_MAX_CHANNELS];
+};
+
+int nl80211_survey_dump(struct nl80211_state *nlstate, int ifindex,
+			struct nl80211_survey_counters *info, int size, int *total);
+
+void nl80211_survey_init(struct nl80211_survey *survey, int ifindex);
+int nl80211_survey_sample(struct nl80211_state *nlstate, struct nl80211_survey *survey);
+struct nl80211_survey_channel *nl80211_survey_channel(struct nl80211_survey *survey,
+						      unsigned int freq);
+int nl80211_survey_utilization(const struct nl80211_survey_channel *channel, int window);
+
+#endif
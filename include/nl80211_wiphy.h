@@ -0,0 +1,83 @@
+#ifndef __NL80211_WIPHY_H
+#define __NL80211_WIPHY_H
+
+#include "nl80211.h"
+#include "nl80211_common.h"
+
+#define NL80211_WIPHY_NAME_LEN 32
+
+/* Channel flags */
+#define NL80211_WIPHY_CHAN_DISABLED		0x0001
+#define NL80211_WIPHY_CHAN_NO_IR		0x0002
+#define NL80211_WIPHY_CHAN_RADAR		0x0004
+#define NL80211_WIPHY_CHAN_NO_HT40_MINUS	0x0008
+#define NL80211_WIPHY_CHAN_NO_HT40_PLUS		0x0010
+#define NL80211_WIPHY_CHAN_NO_80MHZ		0x0020
+#define NL80211_WIPHY_CHAN_NO_160MHZ		0x0040
+#define NL80211_WIPHY_CHAN_INDOOR_ONLY		0x0080
+
+struct nl80211_wiphy_channel
+{
+	unsigned int freq;
+	unsigned short flags;
+	unsigned char band;
+	/* enum nl80211_dfs_state, meaningful for radar channels */
+	unsigned char dfs_state;
+	/* Maximum transmit power in mBm */
+	int max_power;
+};
+
+struct nl80211_wiphy_band
+{
+	int present;
+	int has_ht;
+	int has_vht;
+	int has_he;
+	unsigned short ht_capa;
+	unsigned int vht_capa;
+};
+
+struct nl80211_wiphy_caps
+{
+	int wiphy;
+	char name[NL80211_WIPHY_NAME_LEN];
+	/* Indexed by enum nl80211_band */
+	struct nl80211_wiphy_band bands[NUM_NL80211_BANDS];
+	int n_channels;
+	struct nl80211_wiphy_channel *channels;
+};
+
+/*
+ * Capabilities of every wiphy, parsed from one split NL80211_CMD_GET_WIPHY
+ * dump. A refresh builds a new table and replaces the current one as a
+ * whole, so pointers into the table stay valid until the next refresh.
+ * The table is refreshed when nl80211_wiphy_cache_dispatch() sees a
+ * regulatory change, or a wiphy being added or removed.
+ */
+struct nl80211_wiphy_cache
+{
+	struct nl80211_state *nlstate;
+	int n_wiphys;
+	struct nl80211_wiphy_caps *wiphys;
+	unsigned int generation;
+	/* Regulatory and configuration notifications */
+	struct nl80211_state evstate;
+	struct nl_cb *cb;
+	int changed;
+};
+
+int nl80211_wiphy_cache_init(struct nl80211_wiphy_cache *cache, struct nl80211_state *nlstate);
+void nl80211_wiphy_cache_free(struct nl80211_wiphy_cache *cache);
+int nl80211_wiphy_cache_refresh(struct nl80211_wiphy_cache *cache);
+int nl80211_wiphy_cache_get_fd(struct nl80211_wiphy_cache *cache);
+int nl80211_wiphy_cache_dispatch(struct nl80211_wiphy_cache *cache);
+
+const struct nl80211_wiphy_caps *nl80211_wiphy_cache_get(const struct nl80211_wiphy_cache *cache,
+							 int wiphy);
+const struct nl80211_wiphy_channel *nl80211_wiphy_find_channel(const struct nl80211_wiphy_caps *caps,
+							       unsigned int freq);
+int nl80211_wiphy_freq_usable(const struct nl80211_wiphy_caps *caps, unsigned int freq);
+
+int nl80211_wiphy_of_iface(struct nl80211_state *nlstate, int ifindex);
+
+#endif
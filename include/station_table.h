@@ -0,0 +1,63 @@
+#ifndef __STATION_TABLE_H
+#define __STATION_TABLE_H
+
+#include "mac_addr.h"
+
+#define IP_ADDRESS_BUFFER_LEN 16              //xxx.xxx.xxx.xxx + '\0'
+
+struct station_info
+{
+	/* mac_addr_pack() of addr, what lookups compare */
+	uint64_t key;
+	unsigned char addr[ETH_ALEN];
+	char ip[IP_ADDRESS_BUFFER_LEN];
+	/* free for the table user, zeroed on insertion */
+	unsigned int mark;
+	/* insertion order links, entry indexes or -1 */
+	int prev;
+	int next;
+};
+
+/*
+ * Stations keyed on their binary MAC address.
+ * Entries live in a dense array and are indexed by an open-addressed,
+ * linearly probed hash of slot -> entry index. Deletion shifts the probe
+ * chain back instead of leaving tombstones, so lookups stay short under
+ * churn. Iteration follows insertion order.
+ *
+ * Entry pointers are invalidated by the next insertion.
+ */
+struct station_table
+{
+	struct station_info *entries;
+	int size;
+	int num;
+	int free_list;
+	int head;
+	int tail;
+	int *slots;
+	unsigned int slot_mask;
+};
+
+int station_table_init(struct station_table *t, int size);
+void station_table_free(struct station_table *t);
+
+struct station_info *station_table_lookup(struct station_table *t, const unsigned char *addr);
+struct station_info *station_table_insert(struct station_table *t, const unsigned char *addr);
+int station_table_remove(struct station_table *t, const unsigned char *addr);
+
+static inline struct station_info *station_table_first(struct station_table *t)
+{
+	return t->head < 0 ? NULL : &t->entries[t->head];
+}
+
+static inline struct station_info *station_table_next(struct station_table *t,
+						      struct station_info *sta)
+{
+	return sta->next < 0 ? NULL : &t->entries[sta->next];
+}
+
+#define station_table_for_each(t, sta) \
+	for ((sta) = station_table_first(t); (sta); (sta) = station_table_next(t, sta))
+
+#endif
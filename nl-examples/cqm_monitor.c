@@ -0,0 +1,169 @@
+/*   An example to watch the link quality with RSSI thresholds
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/signalfd.h>
+
+#include "nl80211_cqm.h"
+
+#define DEFAULT_THRESHOLD -70
+#define DEFAULT_HYSTERESIS 4
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-t threshold_dbm]... [-y hysteresis_db] <interface>\n", name);
+}
+
+static void cqm_event(const struct nl80211_cqm_event *ev, void *user_data)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	printf("[%ld.%03ld] ", (long)ts.tv_sec, ts.tv_nsec / 1000000);
+
+	switch (ev->type)
+	{
+		case NL80211_CQM_EVENT_RSSI_LOW:
+			printf("rssi low %d dBm\n", ev->rssi);
+			break;
+		case NL80211_CQM_EVENT_RSSI_HIGH:
+			printf("rssi high %d dBm\n", ev->rssi);
+			break;
+		case NL80211_CQM_EVENT_BEACON_LOSS:
+			printf("beacon loss\n");
+			break;
+		case NL80211_CQM_EVENT_PACKET_LOSS:
+			printf("%u packets lost\n", ev->packets);
+			break;
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	int thresholds[NL80211_CQM_MAX_THRESHOLDS];
+	int n_thresholds = 0, hysteresis = DEFAULT_HYSTERESIS;
+	struct nl80211_cqm_monitor mon;
+	struct nl80211_state nlstate;
+	struct pollfd pfd[2];
+	sigset_t mask;
+	int ifindex, opt, rc, sfd;
+
+	while ((opt = getopt(argc, argv, "t:y:")) != -1)
+	{
+		switch (opt)
+		{
+			case 't':
+				if (n_thresholds < NL80211_CQM_MAX_THRESHOLDS)
+					thresholds[n_thresholds++] = atoi(optarg);
+				break;
+			case 'y':
+				hysteresis = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (!n_thresholds)
+		thresholds[n_thresholds++] = DEFAULT_THRESHOLD;
+
+	ifindex = if_nametoindex(argv[optind]);
+	if (!ifindex)
+	{
+		fprintf(stderr, "Unknown interface %s\n", argv[optind]);
+		return -1;
+	}
+
+	//Subscribe before configuring so no event is missed
+	rc = nl80211_cqm_monitor_init(&mon, ifindex, cqm_event, NULL);
+	if (rc)
+	{
+		fprintf(stderr, "failed to init monitor: %d\n", rc);
+		return rc;
+	}
+
+	rc = nl80211_init(&nlstate);
+	if (rc)
+		goto out_monitor;
+
+	rc = nl80211_cqm_set_rssi(&nlstate, ifindex, thresholds, n_thresholds, hysteresis);
+	if (rc)
+	{
+		fprintf(stderr, "failed to set thresholds: %d\n", rc);
+		goto out;
+	}
+
+	//Stop on SIGINT/SIGTERM through the poll loop so the thresholds get cleared
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+	if (sfd < 0)
+	{
+		perror("signalfd");
+		rc = -1;
+		goto out_unset;
+	}
+
+	pfd[0].fd = nl80211_cqm_monitor_get_fd(&mon);
+	pfd[0].events = POLLIN;
+	pfd[1].fd = sfd;
+	pfd[1].events = POLLIN;
+
+	while (poll(pfd, 2, -1) >= 0)
+	{
+		if (pfd[1].revents & POLLIN)
+		{
+			rc = 0;
+			break;
+		}
+
+		rc = nl80211_cqm_monitor_dispatch(&mon);
+		if (rc < 0)
+		{
+			fprintf(stderr, "failed to receive events: %d\n", rc);
+			break;
+		}
+	}
+
+	close(sfd);
+
+ out_unset:
+	//Leave the interface without monitoring
+	nl80211_cqm_set_rssi(&nlstate, ifindex, NULL, 0, 0);
+
+ out:
+	nl80211_cleanup(&nlstate);
+ out_monitor:
+	nl80211_cqm_monitor_close(&mon);
+	return rc;
+}
@@ -2,6 +2,7 @@
  * This ought to be provided by libnl
  */
 
+#include <string.h>
 #include <asm/errno.h>
 #include <netlink/genl/genl.h>
 #include <netlink/genl/family.h>
@@ -11,6 +12,30 @@
 #include <linux/genetlink.h>
 
 #include "nl80211.h"
+#include "genl.h"
+
+/*
+ * Family and multicast group ids are global, so a process resolves each
+ * family once and serves later lookups from this cache. An entry is
+ * dropped when the controller announces a change of its family, the next
+ * lookup then resolves it again.
+ */
+#define GENL_CACHE_FAMILIES 4
+#define GENL_CACHE_GROUPS 16
+
+struct genl_group_cache {
+	char name[GENL_NAMSIZ];
+	int id;
+};
+
+struct genl_family_cache {
+	char name[GENL_NAMSIZ];
+	int id;
+	int n_groups;
+	struct genl_group_cache groups[GENL_CACHE_GROUPS];
+};
+
+static struct genl_family_cache family_cache[GENL_CACHE_FAMILIES];
 
 static int error_handler(struct sockaddr_nl *nla, struct nlmsgerr *err,
 			 void *arg)
@@ -27,27 +52,34 @@ static int ack_handler(struct nl_msg *msg, void *arg)
 	return NL_STOP;
 }
 
-struct handler_args {
-	const char *group;
-	int id;
-};
+static struct genl_family_cache *cache_find(const char *family)
+{
+	int i;
 
-static int family_handler(struct nl_msg *msg, void *arg)
+	for (i = 0; i < GENL_CACHE_FAMILIES; i++)
+		if (family_cache[i].id > 0 &&
+		    !strncmp(family_cache[i].name, family, GENL_NAMSIZ))
+			return &family_cache[i];
+	return NULL;
+}
+
+static void parse_family(struct genl_family_cache *fam, struct nlattr **tb)
 {
-	struct handler_args *grp = arg;
-	struct nlattr *tb[CTRL_ATTR_MAX + 1];
-	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
 	struct nlattr *mcgrp;
 	int rem_mcgrp;
 
-	nla_parse(tb, CTRL_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
-		  genlmsg_attrlen(gnlh, 0), NULL);
+	fam->id = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+	fam->n_groups = 0;
 
 	if (!tb[CTRL_ATTR_MCAST_GROUPS])
-		return NL_SKIP;
+		return;
 
 	nla_for_each_nested(mcgrp, tb[CTRL_ATTR_MCAST_GROUPS], rem_mcgrp) {
 		struct nlattr *tb_mcgrp[CTRL_ATTR_MCAST_GRP_MAX + 1];
+		struct genl_group_cache *grp;
+
+		if (fam->n_groups == GENL_CACHE_GROUPS)
+			break;
 
 		nla_parse(tb_mcgrp, CTRL_ATTR_MCAST_GRP_MAX,
 			  nla_data(mcgrp), nla_len(mcgrp), NULL);
@@ -55,29 +87,50 @@ static int family_handler(struct nl_msg *msg, void *arg)
 		if (!tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME] ||
 		    !tb_mcgrp[CTRL_ATTR_MCAST_GRP_ID])
 			continue;
-		if (strncmp(nla_data(tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME]),
-			    grp->group, nla_len(tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME])))
-			continue;
+
+		grp = &fam->groups[fam->n_groups++];
+		nla_strlcpy(grp->name, tb_mcgrp[CTRL_ATTR_MCAST_GRP_NAME],
+			    sizeof(grp->name));
 		grp->id = nla_get_u32(tb_mcgrp[CTRL_ATTR_MCAST_GRP_ID]);
-		break;
 	}
+}
 
+static int family_handler(struct nl_msg *msg, void *arg)
+{
+	struct genl_family_cache *fam = arg;
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+
+	nla_parse(tb, CTRL_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[CTRL_ATTR_FAMILY_ID])
+		return NL_SKIP;
+
+	parse_family(fam, tb);
 	return NL_SKIP;
 }
 
-int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *group)
+static struct genl_family_cache *cache_resolve(struct nl_sock *sock,
+					       const char *family, int *err)
 {
+	struct genl_family_cache *fam;
+	struct genl_family_cache resolved;
 	struct nl_msg *msg;
 	struct nl_cb *cb;
-	int ret, ctrlid;
-	struct handler_args grp = {
-		.group = group,
-		.id = -ENOENT,
-	};
+	int ret, i;
+
+	fam = cache_find(family);
+	if (fam)
+		return fam;
+
+	memset(&resolved, 0, sizeof(resolved));
 
 	msg = nlmsg_alloc();
-	if (!msg)
-		return -ENOMEM;
+	if (!msg) {
+		*err = -ENOMEM;
+		return NULL;
+	}
 
 	cb = nl_cb_alloc(NL_CB_DEFAULT);
 	if (!cb) {
@@ -85,9 +138,8 @@ int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *gr
 		goto out_fail_cb;
 	}
 
-	ctrlid = genl_ctrl_resolve(sock, "nlctrl");
-
-	genlmsg_put(msg, 0, 0, ctrlid, 0,
+	/* The controller has a fixed id, no need to resolve nlctrl */
+	genlmsg_put(msg, 0, 0, GENL_ID_CTRL, 0,
 		    0, CTRL_CMD_GETFAMILY, 0);
 
 	ret = -ENOBUFS;
@@ -101,17 +153,111 @@ int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *gr
 
 	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &ret);
 	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &ret);
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, family_handler, &grp);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, family_handler, &resolved);
 
 	while (ret > 0)
 		nl_recvmsgs(sock, cb);
 
-	if (ret == 0)
-		ret = grp.id;
+	if (ret == 0 && resolved.id <= 0)
+		ret = -ENOENT;
+
  nla_put_failure:
  out:
 	nl_cb_put(cb);
  out_fail_cb:
 	nlmsg_free(msg);
-	return ret;
+
+	if (ret < 0) {
+		*err = ret;
+		return NULL;
+	}
+
+	/* Take a free slot, or evict the first one when all are in use */
+	fam = &family_cache[0];
+	for (i = 0; i < GENL_CACHE_FAMILIES; i++)
+		if (family_cache[i].id <= 0) {
+			fam = &family_cache[i];
+			break;
+		}
+
+	*fam = resolved;
+	strncpy(fam->name, family, sizeof(fam->name) - 1);
+	fam->name[sizeof(fam->name) - 1] = '\0';
+	return fam;
+}
+
+int genl_resolve_family(struct nl_sock *sock, const char *family)
+{
+	struct genl_family_cache *fam;
+	int err;
+
+	fam = cache_resolve(sock, family, &err);
+	return fam ? fam->id : err;
+}
+
+int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *group)
+{
+	struct genl_family_cache *fam;
+	int err, i;
+
+	fam = cache_resolve(sock, family, &err);
+	if (!fam)
+		return err;
+
+	for (i = 0; i < fam->n_groups; i++)
+		if (!strncmp(fam->groups[i].name, group, GENL_NAMSIZ))
+			return fam->groups[i].id;
+
+	return -ENOENT;
+}
+
+/* Join the controller notifications, needed by genl_ctrl_event() */
+int genl_ctrl_listen(struct nl_sock *sock)
+{
+	int mcid;
+
+	mcid = nl_get_multicast_id(sock, "nlctrl", "notify");
+	if (mcid < 0)
+		return mcid;
+
+	return nl_socket_add_membership(sock, mcid);
+}
+
+/*
+ * Feed a message received on a socket joined with genl_ctrl_listen().
+ * A controller notification about a family drops its cached ids.
+ * Returns 1 if msg reported a change of family, 0 otherwise.
+ */
+int genl_ctrl_event(struct nl_msg *msg, const char *family)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct genlmsghdr *gnlh = nlmsg_data(nlh);
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct genl_family_cache *fam;
+	const char *name;
+
+	if (nlh->nlmsg_type != GENL_ID_CTRL)
+		return 0;
+
+	switch (gnlh->cmd) {
+	case CTRL_CMD_NEWFAMILY:
+	case CTRL_CMD_DELFAMILY:
+	case CTRL_CMD_NEWMCAST_GRP:
+	case CTRL_CMD_DELMCAST_GRP:
+		break;
+	default:
+		return 0;
+	}
+
+	nla_parse(tb, CTRL_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+	if (!tb[CTRL_ATTR_FAMILY_NAME])
+		return 0;
+
+	name = nla_get_string(tb[CTRL_ATTR_FAMILY_NAME]);
+	fam = cache_find(name);
+	if (fam)
+		memset(fam, 0, sizeof(*fam));
+
+	return !strncmp(name, family, GENL_NAMSIZ);
 }
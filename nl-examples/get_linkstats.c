@@ -0,0 +1,140 @@
+/*   An example to sample the link statistics of a client interface
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "mac_addr.h"
+#include "nl80211_linkstats.h"
+
+#define DEFAULT_INTERVAL_MS 1000
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-i interval_ms] [-n samples] [-w weight] <interface>\n", name);
+}
+
+static void print_rates(const char *label, const struct nl80211_linkstats_rates *r)
+{
+	printf("  %-8s tx %.0f B/s %.1f pkt/s rx %.0f B/s %.1f pkt/s retries %.1f/s (%.2f per pkt) "
+	       "failed %.1f/s beacon loss %.2f/s bitrate tx %.0f rx %.0f kbit/s signal %.1f dBm\n",
+	       label, r->tx_bytes, r->tx_packets, r->rx_bytes, r->rx_packets,
+	       r->tx_retries, r->retry_ratio, r->tx_failed, r->beacon_loss,
+	       r->tx_bitrate, r->rx_bitrate, r->signal_avg);
+}
+
+static void report(struct nl80211_linkstats *ls)
+{
+	char bssid[MAC_ADDRESS_BUFFER_LEN];
+	struct nl80211_linkstats_rates rates;
+
+	mac_addr_n2a(bssid, ls->bssid);
+	printf("%s:\n", bssid);
+
+	if (!nl80211_linkstats_rates(ls, 1, &rates))
+		print_rates("last", &rates);
+	if (!nl80211_linkstats_rates(ls, 0, &rates))
+		print_rates("window", &rates);
+	if (ls->has_ewma)
+		print_rates("ewma", &ls->ewma);
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nl80211_state nlstate;
+	struct nl80211_linkstats ls;
+	struct pollfd pfd;
+	int interval = DEFAULT_INTERVAL_MS, samples = 0, weight = NL80211_LINKSTATS_DEFAULT_WEIGHT;
+	int ifindex, opt, rc, n = 0;
+
+	while ((opt = getopt(argc, argv, "i:n:w:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'i':
+				interval = atoi(optarg);
+				break;
+			case 'n':
+				samples = atoi(optarg);
+				break;
+			case 'w':
+				weight = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (optind >= argc || interval <= 0)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	ifindex = if_nametoindex(argv[optind]);
+	if (!ifindex)
+	{
+		fprintf(stderr, "Unknown interface %s\n", argv[optind]);
+		return -1;
+	}
+
+	if (nl80211_init(&nlstate))
+		return -1;
+
+	rc = nl80211_linkstats_init(&ls, ifindex, interval, weight);
+	if (rc)
+	{
+		fprintf(stderr, "failed to init sampler: %d\n", rc);
+		goto out;
+	}
+
+	//The first sample only sets the reference counters
+	rc = nl80211_linkstats_sample(&nlstate, &ls);
+	if (rc == -ENOTCONN)
+		fprintf(stderr, "%s is not associated\n", argv[optind]);
+
+	pfd.fd = nl80211_linkstats_get_fd(&ls);
+	pfd.events = POLLIN;
+
+	while ((!samples || n < samples) && poll(&pfd, 1, -1) >= 0)
+	{
+		rc = nl80211_linkstats_dispatch(&nlstate, &ls);
+		if (rc == -ENOTCONN)
+			continue;
+		if (rc < 0)
+		{
+			fprintf(stderr, "sample failed: %d\n", rc);
+			break;
+		}
+		if (rc > 0 && ls.count)
+		{
+			report(&ls);
+			n++;
+		}
+	}
+
+	nl80211_linkstats_close(&ls);
+ out:
+	nl80211_cleanup(&nlstate);
+	return rc < 0 && rc != -ENOTCONN ? rc : 0;
+}
@@ -0,0 +1,108 @@
+/*   An example to scan with channel and SSID filters through nl80211
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "nl80211_scan.h"
+
+#define MAX_NUMBER_OF_FREQS 64
+#define MAX_NUMBER_OF_SSIDS 16
+#define MAX_NUMBER_OF_BSS 256
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-p] [-f freq]... [-s ssid]... <interface>\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int freqs[MAX_NUMBER_OF_FREQS];
+	const char *ssids[MAX_NUMBER_OF_SSIDS];
+	struct nl80211_scan_params params;
+	struct nl80211_state nlstate;
+	static struct nl80211_scan_bss bss[MAX_NUMBER_OF_BSS];
+	int ifindex, num, total, opt;
+
+	memset(&params, 0, sizeof(params));
+	params.freqs = freqs;
+	params.ssids = ssids;
+
+	while ((opt = getopt(argc, argv, "pf:s:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p':
+				params.passive = 1;
+				break;
+			case 'f':
+				if (params.n_freqs < MAX_NUMBER_OF_FREQS)
+					freqs[params.n_freqs++] = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				if (params.n_ssids < MAX_NUMBER_OF_SSIDS)
+					ssids[params.n_ssids++] = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	ifindex = if_nametoindex(argv[optind]);
+	if (!ifindex)
+	{
+		fprintf(stderr, "Unknown interface %s\n", argv[optind]);
+		return -1;
+	}
+
+	if (nl80211_init(&nlstate))
+		return -1;
+
+	num = nl80211_scan(&nlstate, ifindex, &params, NL80211_SCAN_TIMEOUT_MS,
+			   bss, MAX_NUMBER_OF_BSS, &total);
+	if (num < 0)
+	{
+		fprintf(stderr, "scan failed: %d\n", num);
+		nl80211_cleanup(&nlstate);
+		return num;
+	}
+
+	for (int i = 0; i < num; i++)
+	{
+		printf("%02x:%02x:%02x:%02x:%02x:%02x freq %u signal %d.%02d dBm seen %u ms ago%s ssid %.*s\n",
+		       bss[i].bssid[0], bss[i].bssid[1], bss[i].bssid[2],
+		       bss[i].bssid[3], bss[i].bssid[4], bss[i].bssid[5],
+		       bss[i].freq, bss[i].signal_mbm / 100, abs(bss[i].signal_mbm % 100),
+		       bss[i].seen_ms_ago, bss[i].associated ? " associated" : "",
+		       bss[i].ssid_len, bss[i].ssid);
+	}
+
+	if (total > num)
+		printf("%d more BSS not shown\n", total - num);
+
+	nl80211_cleanup(&nlstate);
+	return 0;
+}
@@ -14,191 +14,237 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <asm/errno.h>
+#include <unistd.h>
+#include <errno.h>
 #include <netlink/genl/genl.h>
 #include <netlink/genl/family.h>
 #include <netlink/genl/ctrl.h>
 #include <netlink/msg.h>
 #include <netlink/attr.h>
 #include <linux/genetlink.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/inotify.h>
+#include <net/if.h>
 
 #include "genl.h"
 #include "nl80211.h"
+#include "nl80211_common.h"
+#include "nl80211_station.h"
+#include "station_table.h"
+#include "lease_watch.h"
 
+//link statistics are sampled every second, stations are reported every 30 samples
+#define STATION_SAMPLE_INTERVAL_MS 1000
+#define STATION_REPORT_SAMPLES 30
 
-#define ETH_ALEN 6
-#define MAC_ADDRESS_BUFFER_LEN (ETH_ALEN * 3) //xx:xx:xx:xx:xx:xx + '\0'
-#define IP_ADDRESS_BUFFER_LEN 16              //xxx.xxx.xxx.xxx + '\0'
-struct station_info
-{
-	char mac[MAC_ADDRESS_BUFFER_LEN];
-	char ip[IP_ADDRESS_BUFFER_LEN];
-};
+//initial table size, both tables grow on demand
+#define STATION_TABLE_INITIAL_SIZE 16
 
-//dhcp lease file
-#define DNSMASQ_LEASE_FILE_FOR_WLAN0 "/var/lib/NetworkManager/dnsmasq-wlan0.leases"
+#define MAX_EPOLL_EVENTS 8
 
-//max 10 active stations
-#define MAX_NUMBER_OF_ACTIVE_STATIONS 10
-#define is_sta_valid(x) (x.mac[2] == ':')
+//event socket receive buffer, sized for a burst of events from ~100 stations
+#define DEFAULT_RX_BUFFER_SIZE (1024 * 1024)
 
-struct nl80211_state
+//Per access point interface state
+struct ap_iface
 {
-	struct nl_sock *nl_sock;
-	int nl80211_id;
+	int ifindex;
+	char ifname[IF_NAMESIZE];
+	struct station_table stations;
+	struct nl80211_station_table stats;
+	//dhcp leases, re-parsed when the file changes or a station joins
+	struct lease_watch leases;
+	int leases_stale;
+	//station table to be rebuilt from a dump
+	int stations_stale;
+	unsigned int mark;
 };
 
 struct gen_nl_params
 {
+	//one socket receives the mlme events of every wiphy
 	struct nl80211_state nlstate;
 	struct nl_cb *cb;
+	//requests go through their own socket so they never consume events
+	struct nl80211_state reqstate;
+	int epfd;
+	int tfd;
+	int ifd;
+	struct ap_iface *ifaces;
+	int num_ifaces;
+	//no -i given, interfaces follow the AP mode as they come and go
+	int auto_ifaces;
+	//resync generations, of the station tables and of the interface list
+	unsigned int resync_mark;
+	unsigned int iface_mark;
+	//nl80211 was registered again, its ids must be resolved again
+	int family_changed;
 };
 
 
-//Get stations' ip addresses from dnsmasq-wlan0.leases
-static int get_ip_addresses(struct station_info *sta, int size)
+static struct ap_iface *find_iface(struct gen_nl_params *params, int ifindex)
 {
-	char epoch_time[256], mac[256], ip[68], name[256], client_id[768];
-
-	FILE *fp = fopen(DNSMASQ_LEASE_FILE_FOR_WLAN0, "r");
-	if (!fp)
-		return -ENOENT;
-
-	//Always update all clients' ip addresses in case of ip changes without events
-	while (fscanf(fp, "%255s %255s %64s %255s %764s", epoch_time, mac, ip, name, client_id) >= 3)
+	for (int i = 0; i < params->num_ifaces; i++)
 	{
-		for(int i=0; i<size; i++)
-		{
-			if(is_sta_valid(sta[i]))
-			{
-				if(memcmp(sta[i].mac, mac, MAC_ADDRESS_BUFFER_LEN))
-					continue;
-
-				memcpy(sta[i].ip, ip, IP_ADDRESS_BUFFER_LEN);
-				sta[i].ip[IP_ADDRESS_BUFFER_LEN-1] = '\0';
-			}
-			break;
-		}
+		if (params->ifaces[i].ifindex == ifindex)
+			return &params->ifaces[i];
 	}
 
-	fclose(fp);
-	return 0;
+	return NULL;
 }
 
-
-//Append new item to the next available slot
-static int add_station(struct station_info *sta, const char *mac)
+static int add_iface(struct gen_nl_params *params, const char *ifname, const char *lease_file)
 {
-	for(int i=0; i<MAX_NUMBER_OF_ACTIVE_STATIONS; i++)
+	struct ap_iface *iface, *ifaces;
+	char path[256];
+	int ifindex, rc;
+
+	ifindex = if_nametoindex(ifname);
+	if (!ifindex)
 	{
-		if(is_sta_valid(sta[i]))
-		{
-			//In case a device disconnected without sending NL80211_CMD_DEL_STATION message and then reconnects
-			if(memcmp(sta[i].mac, mac, MAC_ADDRESS_BUFFER_LEN) == 0)
-				return 0;
-		}
-		else
-		{
-			memcpy(sta[i].mac, mac, MAC_ADDRESS_BUFFER_LEN);
-			return 0;
-		}
+		fprintf(stderr, "Unknown interface %s\n", ifname);
+		return -ENODEV;
 	}
 
-	fprintf(stderr, "Too many active stations.\n");
-	return -1;
-}
+	if (find_iface(params, ifindex))
+		return 0;
 
-//Delete item by overriding with subsequent items
-static int del_station(struct station_info *sta, const char *mac)
-{
-	int i;
+	ifaces = realloc(params->ifaces, (params->num_ifaces + 1) * sizeof(*ifaces));
+	if (!ifaces)
+		return -ENOMEM;
+	params->ifaces = ifaces;
 
-	for(i=0; i<MAX_NUMBER_OF_ACTIVE_STATIONS; i++)
-	{
-		if(memcmp(sta[i].mac, mac, MAC_ADDRESS_BUFFER_LEN) == 0)
-		{
-			break;
-		}
-	}
+	iface = &ifaces[params->num_ifaces];
+	memset(iface, 0, sizeof(*iface));
+	iface->ifindex = ifindex;
+	snprintf(iface->ifname, sizeof(iface->ifname), "%s", ifname);
+
+	rc = station_table_init(&iface->stations, STATION_TABLE_INITIAL_SIZE);
+	if (rc)
+		return rc;
 
-	if(i == MAX_NUMBER_OF_ACTIVE_STATIONS)
+	rc = nl80211_station_table_init(&iface->stats, STATION_TABLE_INITIAL_SIZE);
+	if (rc)
 	{
-		fprintf(stderr, "Unable to find device %s\n", mac);
-		return -1;
+		station_table_free(&iface->stations);
+		return rc;
 	}
 
-	for(; i<(MAX_NUMBER_OF_ACTIVE_STATIONS - 1); i++)
+	if (!lease_file)
 	{
-		memcpy(&sta[i], &sta[i+1], sizeof(struct station_info));
+		snprintf(path, sizeof(path), DNSMASQ_LEASE_FILE_FORMAT, ifname);
+		lease_file = path;
 	}
 
-	memset(&sta[i], 0, sizeof(struct station_info));
+	if (lease_watch_init(&iface->leases, params->ifd, lease_file))
+		fprintf(stderr, "Unable to watch %s, %s ip addresses disabled\n", lease_file, ifname);
+	iface->leases_stale = 1;
+	iface->stations_stale = 1;
+	iface->mark = params->iface_mark;
 
+	params->num_ifaces++;
+	printf("%s: tracked\n", iface->ifname);
 	return 0;
 }
 
-static void mac_addr_n2a(char *mac, const unsigned char *arg)
+static void free_iface(struct ap_iface *iface)
 {
-	int i, l;
+	station_table_free(&iface->stations);
+	nl80211_station_table_free(&iface->stats);
+	lease_watch_close(&iface->leases);
+}
 
-	l = 0;
-	for (i = 0; i < ETH_ALEN ; i++)
-	{
-		if (i == 0)
-		{
-			sprintf(mac+l, "%02x", arg[i]);
-			l += 2;
-		}
-		else
-		{
-			sprintf(mac+l, ":%02x", arg[i]);
-			l += 3;
-		}
-	}
+static void remove_iface(struct gen_nl_params *params, struct ap_iface *iface)
+{
+	int i = iface - params->ifaces;
+
+	printf("%s: no longer tracked\n", iface->ifname);
+	free_iface(iface);
+	memmove(iface, iface + 1, (params->num_ifaces - i - 1) * sizeof(*iface));
+	params->num_ifaces--;
 }
 
-static int nl80211_init(struct nl80211_state *nlstate)
+static void free_ifaces(struct gen_nl_params *params)
 {
-	int err;
+	for (int i = 0; i < params->num_ifaces; i++)
+		free_iface(&params->ifaces[i]);
 
-	nlstate->nl_sock = nl_socket_alloc();
-	if (!nlstate->nl_sock) {
-		fprintf(stderr, "Failed to allocate netlink socket.\n");
-		return -ENOMEM;
-	}
+	free(params->ifaces);
+	params->ifaces = NULL;
+	params->num_ifaces = 0;
+}
 
-	if (genl_connect(nlstate->nl_sock)) {
-		fprintf(stderr, "Failed to connect to generic netlink.\n");
-		err = -ENOLINK;
-		goto out_handle_destroy;
-	}
+/*
+ * Follow an interface reported by a dump or a config event. Without -i,
+ * interfaces are tracked while they run in AP mode.
+ */
+static void ap_iface_update(struct gen_nl_params *params, struct nlattr **tb)
+{
+	struct ap_iface *iface;
+	int ap;
 
-	nl_socket_set_buffer_size(nlstate->nl_sock, 8192, 8192);
+	if (!tb[NL80211_ATTR_IFINDEX] || !tb[NL80211_ATTR_IFNAME] || !tb[NL80211_ATTR_IFTYPE])
+		return;
 
-	/* try to set NETLINK_EXT_ACK to 1, ignoring errors */
-	err = 1;
-	setsockopt(nl_socket_get_fd(nlstate->nl_sock), SOL_NETLINK,
-		   NETLINK_EXT_ACK, &err, sizeof(err));
+	iface = find_iface(params, nla_get_u32(tb[NL80211_ATTR_IFINDEX]));
+	ap = nla_get_u32(tb[NL80211_ATTR_IFTYPE]) == NL80211_IFTYPE_AP;
 
-	nlstate->nl80211_id = genl_ctrl_resolve(nlstate->nl_sock, "nl80211");
-	if (nlstate->nl80211_id < 0) {
-		fprintf(stderr, "nl80211 not found.\n");
-		err = -ENOENT;
-		goto out_handle_destroy;
+	if (iface)
+	{
+		iface->mark = params->iface_mark;
+		if (!ap && params->auto_ifaces)
+			remove_iface(params, iface);
+	}
+	else if (ap && params->auto_ifaces)
+	{
+		add_iface(params, nla_get_string(tb[NL80211_ATTR_IFNAME]), NULL);
 	}
+}
 
-	return 0;
+static int iface_dump_handler(struct nl_msg *msg, void *arg)
+{
+	struct gen_nl_params *params = (struct gen_nl_params *)arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+
+	nl80211_parse(msg, tb);
+	ap_iface_update(params, tb);
 
- out_handle_destroy:
-	nl_socket_free(nlstate->nl_sock);
-	return err;
+	return NL_SKIP;
 }
 
-static int no_seq_check(struct nl_msg *msg, void *arg)
+static int dump_ifaces(struct gen_nl_params *params)
 {
-	return NL_OK;
+	struct nl_msg *msg;
+
+	msg = nl80211_msg_alloc(&params->reqstate, NL80211_CMD_GET_INTERFACE, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	return nl80211_send_and_recv(&params->reqstate, msg, iface_dump_handler, params);
+}
+
+/*
+ * Rebuild the interface list from a full interface dump, after config
+ * events may have been lost. Interfaces that went away are dropped.
+ */
+static void resync_ifaces(struct gen_nl_params *params)
+{
+	params->iface_mark++;
+	if (dump_ifaces(params) < 0)
+	{
+		fprintf(stderr, "Unable to resync interfaces\n");
+		return;
+	}
+
+	for (int i = params->num_ifaces - 1; i >= 0; i--)
+	{
+		if (params->ifaces[i].mark != params->iface_mark)
+			remove_iface(params, &params->ifaces[i]);
+	}
 }
 
 static int nl80211_event_handle(struct nl_msg *msg, void *arg)
@@ -206,20 +252,60 @@ static int nl80211_event_handle(struct nl_msg *msg, void *arg)
 	char macbuf[MAC_ADDRESS_BUFFER_LEN];
 	struct nlattr *tb[NL80211_ATTR_MAX + 1];
 	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
-	struct station_info *sta = (struct station_info *)arg;
+	struct gen_nl_params *params = (struct gen_nl_params *)arg;
+	struct ap_iface *iface;
+
+	if (genl_ctrl_event(msg, "nl80211"))
+	{
+		params->family_changed = 1;
+		return NL_SKIP;
+	}
 
 	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
 			  genlmsg_attrlen(gnlh, 0), NULL);
 
+	switch (gnlh->cmd)
+	{
+		case NL80211_CMD_NEW_INTERFACE:
+		case NL80211_CMD_SET_INTERFACE:
+			ap_iface_update(params, tb);
+			return NL_SKIP;
+		case NL80211_CMD_DEL_INTERFACE:
+			//Whether given with -i or not, the ifindex is gone for good
+			if (tb[NL80211_ATTR_IFINDEX])
+			{
+				iface = find_iface(params, nla_get_u32(tb[NL80211_ATTR_IFINDEX]));
+				if (iface)
+					remove_iface(params, iface);
+			}
+			return NL_SKIP;
+		default:
+			break;
+	}
+
+	if (!tb[NL80211_ATTR_MAC] || !tb[NL80211_ATTR_IFINDEX])
+		return NL_SKIP;
+
+	//Events of every wiphy arrive here, keep those of tracked interfaces
+	iface = find_iface(params, nla_get_u32(tb[NL80211_ATTR_IFINDEX]));
+	if (!iface)
+		return NL_SKIP;
+
 	switch (gnlh->cmd)
 	{
 		case NL80211_CMD_NEW_STATION:
-			mac_addr_n2a(macbuf, nla_data(tb[NL80211_ATTR_MAC]));
-			add_station(sta, macbuf);
+			//A device may disconnect without NL80211_CMD_DEL_STATION and then reconnect
+			if (!station_table_insert(&iface->stations, nla_data(tb[NL80211_ATTR_MAC])))
+				fprintf(stderr, "Out of memory for new station.\n");
+			//Its lease may already be in the file if it is reconnecting
+			iface->leases_stale = 1;
 		    break;
 		case NL80211_CMD_DEL_STATION:
-			mac_addr_n2a(macbuf, nla_data(tb[NL80211_ATTR_MAC]));
-			del_station(sta, macbuf);
+			if (station_table_remove(&iface->stations, nla_data(tb[NL80211_ATTR_MAC])))
+			{
+				mac_addr_n2a(macbuf, nla_data(tb[NL80211_ATTR_MAC]));
+				fprintf(stderr, "Unable to find device %s on %s\n", macbuf, iface->ifname);
+			}
 		    break;
 		default:
 			break;
@@ -242,7 +328,12 @@ int nl80211_listen(struct nl80211_state *nlstate)
 	if (ret)
 		return ret;
 
-	return 0;
+	/* and to the config group for interfaces coming, going and changing type */
+	mcid = nl_get_multicast_id(nlstate->nl_sock, "nl80211", "config");
+	if (mcid < 0)
+		return mcid;
+
+	return nl_socket_add_membership(nlstate->nl_sock, mcid);
 }
 
 static void event_close(struct gen_nl_params *params)
@@ -250,98 +341,350 @@ static void event_close(struct gen_nl_params *params)
 	if(params->cb != NULL)
 		nl_cb_put(params->cb);
 
-	if(params->nlstate.nl_sock != NULL)
-		nl_socket_free(params->nlstate.nl_sock);
+	nl80211_cleanup(&params->nlstate);
+	nl80211_cleanup(&params->reqstate);
+	free_ifaces(params);
+
+	if (params->epfd >= 0)
+		close(params->epfd);
+	if (params->tfd >= 0)
+		close(params->tfd);
+	if (params->ifd >= 0)
+		close(params->ifd);
 
 	return;
 }
 
-static int event_init(struct gen_nl_params *params, void *arg)
+static int epoll_add(int epfd, int fd)
 {
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) ? -errno : 0;
+}
+
+static int event_init(struct gen_nl_params *params)
+{
+	struct itimerspec its;
 	int rc;
 
+	params->epfd = epoll_create1(EPOLL_CLOEXEC);
+	params->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	params->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (params->epfd < 0 || params->tfd < 0 || params->ifd < 0)
+		return -errno;
+
 	rc = nl80211_init(&params->nlstate);
 	if (rc)
 		return rc;
 
+	//nl80211 is resolved by now, only nlctrl is looked up before joining groups
+	rc = genl_ctrl_listen(params->nlstate.nl_sock);
+	if (rc)
+		return rc;
+
 	rc = nl80211_listen(&params->nlstate);
 	if (rc)
-	{
-		event_close(params);
 		return rc;
-	}
 
-	params->cb = nl_cb_alloc(NL_CB_DEFAULT);
+	params->cb = nl80211_event_cb_alloc(&params->nlstate, nl80211_event_handle, params);
 	if (!params->cb)
-	{
-		event_close(params);
 		return -ENOMEM;
+
+	rc = nl80211_init(&params->reqstate);
+	if (rc)
+		return rc;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_nsec = 1;
+	its.it_interval.tv_sec = STATION_SAMPLE_INTERVAL_MS / 1000;
+	its.it_interval.tv_nsec = (STATION_SAMPLE_INTERVAL_MS % 1000) * 1000000;
+	if (timerfd_settime(params->tfd, 0, &its, NULL))
+		return -errno;
+
+	rc = epoll_add(params->epfd, nl_socket_get_fd(params->nlstate.nl_sock));
+	if (!rc)
+		rc = epoll_add(params->epfd, params->tfd);
+	if (!rc)
+		rc = epoll_add(params->epfd, params->ifd);
+
+	return rc;
+}
+
+static void sample_stations(struct gen_nl_params *params, struct ap_iface *iface)
+{
+	struct nl80211_station_table *t = &iface->stats;
+	char macbuf[MAC_ADDRESS_BUFFER_LEN];
+	int i;
+
+	if (nl80211_station_dump(&params->reqstate, iface->ifindex, t) < 0)
+		return;
+
+	for (i = 0; i < t->num; i++)
+	{
+		mac_addr_n2a(macbuf, t->mac[i]);
+		printf("%s %s: signal %d dBm inactive %u ms rx %llu bytes %u packets "
+			"tx %llu bytes %u packets %u retries %u failed "
+			"bitrate tx %u.%u rx %u.%u MBit/s\n",
+			iface->ifname, macbuf, t->signal[i], t->inactive_ms[i],
+			t->rx_bytes[i], t->rx_packets[i],
+			t->tx_bytes[i], t->tx_packets[i], t->tx_retries[i], t->tx_failed[i],
+			t->tx_bitrate[i] / 10, t->tx_bitrate[i] % 10,
+			t->rx_bitrate[i] / 10, t->rx_bitrate[i] % 10);
+	}
+}
+
+static void report_stations(struct ap_iface *iface)
+{
+	struct station_info *sta;
+	char macbuf[MAC_ADDRESS_BUFFER_LEN];
+	int i = 0;
+
+	station_table_for_each(&iface->stations, sta)
+	{
+		mac_addr_n2a(macbuf, sta->addr);
+		printf("%s device-%d: mac: %s ip %s\n", iface->ifname, i++, macbuf, sta->ip);
 	}
+}
 
-	nl_socket_set_nonblocking(params->nlstate.nl_sock);
+/*
+ * Rebuild the station table of an interface from a full station dump,
+ * after events may have been lost
+ */
+static void resync_stations(struct gen_nl_params *params, struct ap_iface *iface)
+{
+	struct nl80211_station_table *t = &iface->stats;
+	struct station_info *sta, *next;
+	unsigned int mark = ++params->resync_mark;
+	int i;
 
-	// no sequence checking for multicast messages
-	nl_cb_set(params->cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, no_seq_check, NULL);
-	nl_cb_set(params->cb, NL_CB_VALID, NL_CB_CUSTOM, nl80211_event_handle, arg);
+	if (nl80211_station_dump(&params->reqstate, iface->ifindex, t) < 0)
+	{
+		fprintf(stderr, "Unable to resync stations of %s\n", iface->ifname);
+		return;
+	}
 
-	return 0;
+	for (i = 0; i < t->num; i++)
+	{
+		sta = station_table_insert(&iface->stations, t->mac[i]);
+		if (sta)
+			sta->mark = mark;
+	}
+
+	for (sta = station_table_first(&iface->stations); sta; sta = next)
+	{
+		next = station_table_next(&iface->stations, sta);
+		if (sta->mark != mark)
+			station_table_remove(&iface->stations, sta->addr);
+	}
+
+	iface->stations_stale = 0;
+	iface->leases_stale = 1;
 }
 
-static void event_process(struct gen_nl_params *params, struct station_info *sta)
+/*
+ * nl80211 came back, e.g. after a driver reload. Resolve the family and
+ * its groups again and rebuild the interface and station tables. The
+ * group ids then come from the cache filled by the request socket.
+ */
+static void family_refresh(struct gen_nl_params *params)
 {
-	int fds;
-	fd_set rx;
-	struct timeval tv;
+	int id, rc;
 
-	while(1)
+	//The event socket is nonblocking and joined to groups, resolve elsewhere
+	id = genl_resolve_family(params->reqstate.nl_sock, "nl80211");
+	if (id < 0)
+		return;
+
+	params->nlstate.nl80211_id = id;
+	params->reqstate.nl80211_id = id;
+
+	rc = nl80211_listen(&params->nlstate);
+	if (rc)
 	{
-		fds = nl_socket_get_fd(params->nlstate.nl_sock);
-		FD_ZERO(&rx);
-		FD_SET(fds, &rx);
+		fprintf(stderr, "Unable to listen to nl80211 events (%d)\n", rc);
+		return;
+	}
 
-		tv.tv_sec = 30;
-		tv.tv_usec = 0;
+	params->family_changed = 0;
+	resync_ifaces(params);
+	for (int i = 0; i < params->num_ifaces; i++)
+		resync_stations(params, &params->ifaces[i]);
+}
 
-		if(select(fds+1, &rx, NULL, NULL, &tv) > 0)
+/*
+ * Process every pending event. After an overrun of the receive buffer the
+ * interface list and the station tables are rebuilt from dumps.
+ */
+static void event_receive(struct gen_nl_params *params)
+{
+	int overrun;
+
+	overrun = nl80211_event_drain(&params->nlstate, params->cb);
+
+	if (params->family_changed)
+		family_refresh(params);
+
+	if (overrun <= 0)
+		return;
+
+	fprintf(stderr, "Netlink events lost, resyncing interfaces and stations\n");
+	resync_ifaces(params);
+	for (int i = 0; i < params->num_ifaces; i++)
+		resync_stations(params, &params->ifaces[i]);
+}
+
+static void lease_event(const struct inotify_event *ev, void *arg)
+{
+	struct gen_nl_params *params = (struct gen_nl_params *)arg;
+
+	for (int i = 0; i < params->num_ifaces; i++)
+	{
+		if (lease_watch_match(&params->ifaces[i].leases, ev))
+			params->ifaces[i].leases_stale = 1;
+	}
+}
+
+static void event_process(struct gen_nl_params *params)
+{
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	struct ap_iface *iface;
+	uint64_t expirations;
+	unsigned int samples = 0;
+	int nlfd = nl_socket_get_fd(params->nlstate.nl_sock);
+	int i, n;
+
+	while(1)
+	{
+		n = epoll_wait(params->epfd, events, MAX_EPOLL_EVENTS, -1);
+		if (n < 0)
 		{
-			nl_recvmsgs(params->nlstate.nl_sock, params->cb);
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
+			return;
 		}
-		else
-		{
-			get_ip_addresses(sta, MAX_NUMBER_OF_ACTIVE_STATIONS);
 
-			for(int i=0; i<MAX_NUMBER_OF_ACTIVE_STATIONS; i++)
+		for (i = 0; i < n; i++)
+		{
+			if (events[i].data.fd == nlfd)
+			{
+				event_receive(params);
+			}
+			else if (events[i].data.fd == params->ifd)
+			{
+				lease_watch_read(params->ifd, lease_event, params);
+			}
+			else if (events[i].data.fd == params->tfd)
 			{
-				if(is_sta_valid(sta[i]))
+				if (read(params->tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+					continue;
+
+				samples++;
+				for (int j = 0; j < params->num_ifaces; j++)
 				{
-					printf("device-%d: mac: %s ip %s\n", i, sta[i].mac, sta[i].ip);
+					sample_stations(params, &params->ifaces[j]);
+					if (samples % STATION_REPORT_SAMPLES == 0)
+						report_stations(&params->ifaces[j]);
 				}
 			}
 		}
+
+		for (i = 0; i < params->num_ifaces; i++)
+		{
+			iface = &params->ifaces[i];
+			//Interfaces that were just added start from their associated stations
+			if (iface->stations_stale)
+				resync_stations(params, iface);
+
+			if (!iface->leases_stale || iface->leases.wd < 0)
+				continue;
+
+			iface->leases_stale = 0;
+			if (lease_watch_parse(&iface->leases, &iface->stations) > 0)
+				report_stations(iface);
+		}
 	}
 
 	return;
 }
 
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-b rx_buffer_size] [-i interface[:lease_file]]...\n", name);
+	fprintf(stderr, "Without -i, every interface in AP mode is tracked, including the ones\n"
+			"created or switched to AP mode later.\n");
+}
 
 int main(int argc, char *argv[])
 {
-	int rc = 0;
+	int rc = 0, opt;
+	int rxbuf = DEFAULT_RX_BUFFER_SIZE;
 	struct gen_nl_params params;
-	struct station_info sta[MAX_NUMBER_OF_ACTIVE_STATIONS];
+	char *lease_file;
 
-	memset(sta, 0, sizeof(sta));
 	memset(&params, 0, sizeof(params));
+	params.epfd = -1;
+	params.tfd = -1;
+	params.ifd = -1;
 
-	rc = event_init(&params, (void *)sta);
+	rc = event_init(&params);
 	if(rc < 0)
 	{
 		fprintf(stderr, "failed to init event\n");
+		event_close(&params);
 		return rc;
 	}
 
-	event_process(&params, sta);
+	while ((opt = getopt(argc, argv, "b:i:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				rxbuf = strtol(optarg, NULL, 0);
+				break;
+			case 'i':
+				lease_file = strchr(optarg, ':');
+				if (lease_file)
+					*lease_file++ = '\0';
+				rc = add_iface(&params, optarg, lease_file);
+				if (rc < 0)
+					goto out;
+				break;
+			default:
+				usage(argv[0]);
+				rc = -1;
+				goto out;
+		}
+	}
+
+	rc = nl80211_set_buffer_size(&params.nlstate, rxbuf, 0);
+	if (rc < 0)
+	{
+		fprintf(stderr, "failed to set buffer size\n");
+		goto out;
+	}
+
+	if (!params.num_ifaces)
+	{
+		params.auto_ifaces = 1;
+		rc = dump_ifaces(&params);
+		if (rc < 0)
+			goto out;
+
+		if (!params.num_ifaces)
+			printf("No interface in AP mode yet\n");
+	}
+
+	//Start from the stations already associated
+	for (int i = 0; i < params.num_ifaces; i++)
+		resync_stations(&params, &params.ifaces[i]);
+
+	event_process(&params);
 
+ out:
 	event_close(&params);
 	return rc;
 }
@@ -0,0 +1,130 @@
+/*   An example to sample channel survey data and report channel utilization
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/timerfd.h>
+
+#include "nl80211_survey.h"
+
+#define DEFAULT_INTERVAL_MS 1000
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-i interval_ms] [-n samples] <interface>\n", name);
+}
+
+static void report(struct nl80211_survey *survey)
+{
+	struct nl80211_survey_channel *ch;
+	struct nl80211_survey_delta *d;
+
+	for (int i = 0; i < survey->n_channels; i++)
+	{
+		ch = &survey->channels[i];
+		if (!ch->count)
+			continue;
+
+		d = &ch->ring[(ch->head + NL80211_SURVEY_RING_SIZE - 1) % NL80211_SURVEY_RING_SIZE];
+		printf("freq %u%s noise %d dBm active %llu ms busy %llu ms rx %llu ms tx %llu ms "
+		       "utilization %d%% (%d%% over %d samples)\n",
+		       ch->freq, ch->in_use ? " [in use]" : "", d->noise,
+		       d->time, d->time_busy, d->time_rx, d->time_tx,
+		       nl80211_survey_utilization(ch, 1),
+		       nl80211_survey_utilization(ch, 0), ch->count);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct nl80211_state nlstate;
+	static struct nl80211_survey survey;
+	struct itimerspec its;
+	uint64_t expirations;
+	int interval = DEFAULT_INTERVAL_MS, samples = 0;
+	int ifindex, opt, tfd, rc;
+
+	while ((opt = getopt(argc, argv, "i:n:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'i':
+				interval = atoi(optarg);
+				break;
+			case 'n':
+				samples = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (optind >= argc || interval <= 0)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	ifindex = if_nametoindex(argv[optind]);
+	if (!ifindex)
+	{
+		fprintf(stderr, "Unknown interface %s\n", argv[optind]);
+		return -1;
+	}
+
+	if (nl80211_init(&nlstate))
+		return -1;
+
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (tfd < 0)
+	{
+		perror("timerfd_create");
+		nl80211_cleanup(&nlstate);
+		return -1;
+	}
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = interval / 1000;
+	its.it_value.tv_nsec = (interval % 1000) * 1000000;
+	its.it_interval = its.it_value;
+	timerfd_settime(tfd, 0, &its, NULL);
+
+	nl80211_survey_init(&survey, ifindex);
+
+	//The first sample only sets the reference counters
+	rc = nl80211_survey_sample(&nlstate, &survey);
+	for (int n = 0; rc >= 0 && (!samples || n < samples); n++)
+	{
+		if (read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+			break;
+
+		rc = nl80211_survey_sample(&nlstate, &survey);
+		if (rc >= 0)
+			report(&survey);
+	}
+
+	if (rc < 0)
+		fprintf(stderr, "survey failed: %d\n", rc);
+
+	close(tfd);
+	nl80211_cleanup(&nlstate);
+	return rc < 0 ? rc : 0;
+}
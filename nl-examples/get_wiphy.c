@@ -0,0 +1,144 @@
+/*   An example to list wiphy capabilities and follow regulatory changes
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "nl80211_wiphy.h"
+
+static const char *band_names[NUM_NL80211_BANDS] = {
+	[NL80211_BAND_2GHZ] = "2.4 GHz",
+	[NL80211_BAND_5GHZ] = "5 GHz",
+	[NL80211_BAND_60GHZ] = "60 GHz",
+	[NL80211_BAND_6GHZ] = "6 GHz",
+};
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-w]\n", name);
+	fprintf(stderr, "  -w  keep running and print the table again on changes\n");
+}
+
+static void print_caps(const struct nl80211_wiphy_caps *caps)
+{
+	const struct nl80211_wiphy_channel *ch;
+	const struct nl80211_wiphy_band *b;
+
+	printf("phy#%d %s\n", caps->wiphy, caps->name);
+
+	for (int i = 0; i < NUM_NL80211_BANDS; i++)
+	{
+		b = &caps->bands[i];
+		if (!b->present)
+			continue;
+
+		printf("  band %s:", band_names[i] ? band_names[i] : "unknown");
+		if (b->has_ht)
+			printf(" HT (0x%04x)", b->ht_capa);
+		if (b->has_vht)
+			printf(" VHT (0x%08x)", b->vht_capa);
+		if (b->has_he)
+			printf(" HE");
+		printf("\n");
+
+		for (int j = 0; j < caps->n_channels; j++)
+		{
+			ch = &caps->channels[j];
+			if (ch->band != i)
+				continue;
+
+			printf("    %u MHz", ch->freq);
+			if (ch->flags & NL80211_WIPHY_CHAN_DISABLED)
+			{
+				printf(" (disabled)\n");
+				continue;
+			}
+			printf(" %d.%02d dBm", ch->max_power / 100, ch->max_power % 100);
+			if (ch->flags & NL80211_WIPHY_CHAN_NO_IR)
+				printf(" no-IR");
+			if (ch->flags & NL80211_WIPHY_CHAN_RADAR)
+				printf(" radar (dfs state %u)", ch->dfs_state);
+			if (ch->flags & NL80211_WIPHY_CHAN_INDOOR_ONLY)
+				printf(" indoor");
+			printf("\n");
+		}
+	}
+}
+
+static void print_cache(const struct nl80211_wiphy_cache *cache)
+{
+	for (int i = 0; i < cache->n_wiphys; i++)
+		print_caps(&cache->wiphys[i]);
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nl80211_wiphy_cache cache;
+	struct nl80211_state nlstate;
+	struct pollfd pfd;
+	int watch = 0, opt, rc;
+
+	while ((opt = getopt(argc, argv, "w")) != -1)
+	{
+		switch (opt)
+		{
+			case 'w':
+				watch = 1;
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (nl80211_init(&nlstate))
+		return -1;
+
+	rc = nl80211_wiphy_cache_init(&cache, &nlstate);
+	if (rc)
+	{
+		fprintf(stderr, "failed to read wiphys: %d\n", rc);
+		nl80211_cleanup(&nlstate);
+		return rc;
+	}
+
+	print_cache(&cache);
+
+	pfd.fd = nl80211_wiphy_cache_get_fd(&cache);
+	pfd.events = POLLIN;
+
+	while (watch && poll(&pfd, 1, -1) >= 0)
+	{
+		rc = nl80211_wiphy_cache_dispatch(&cache);
+		if (rc < 0)
+		{
+			fprintf(stderr, "failed to refresh wiphys: %d\n", rc);
+			break;
+		}
+		if (rc > 0)
+		{
+			printf("-- generation %u\n", cache.generation);
+			print_cache(&cache);
+		}
+	}
+
+	nl80211_wiphy_cache_free(&cache);
+	nl80211_cleanup(&nlstate);
+	return rc < 0 ? rc : 0;
+}
@@ -0,0 +1,224 @@
+/*   Incremental dnsmasq lease file parser driven by inotify
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "lease_watch.h"
+
+/* dnsmasq keeps the lease file open, so IN_CLOSE_WRITE alone is not enough */
+#define LEASE_WATCH_EVENTS (IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE)
+
+/* Add a watch for path to the inotify descriptor fd */
+int lease_watch_init(struct lease_watch *lw, int fd, const char *path)
+{
+	char *slash;
+	int err;
+
+	memset(lw, 0, sizeof(*lw));
+	lw->wd = -1;
+
+	lw->path = strdup(path);
+	if (!lw->path)
+		return -ENOMEM;
+
+	/* Watch the directory, then filter events on the file name */
+	slash = strrchr(lw->path, '/');
+	if (slash) {
+		*slash = '\0';
+		lw->wd = inotify_add_watch(fd, slash == lw->path ? "/" : lw->path,
+					   LEASE_WATCH_EVENTS);
+		*slash = '/';
+		lw->name = slash + 1;
+	} else {
+		lw->wd = inotify_add_watch(fd, ".", LEASE_WATCH_EVENTS);
+		lw->name = lw->path;
+	}
+	if (lw->wd < 0) {
+		err = -errno;
+		free(lw->path);
+		memset(lw, 0, sizeof(*lw));
+		lw->wd = -1;
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * The directory watch is left in place, other lease files of the same
+ * directory may share it. It goes away with the inotify descriptor.
+ */
+void lease_watch_close(struct lease_watch *lw)
+{
+	free(lw->path);
+	free(lw->buf);
+	memset(lw, 0, sizeof(*lw));
+	lw->wd = -1;
+}
+
+/*
+ * Drain the pending events of an inotify descriptor, calling handler for
+ * each of them. Returns 0, or a negative error code.
+ */
+int lease_watch_read(int fd, void (*handler)(const struct inotify_event *ev, void *arg),
+		     void *arg)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+
+	for (;;) {
+		len = read(fd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				return 0;
+			return -errno;
+		}
+		if (len == 0)
+			return 0;
+
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			handler(ev, arg);
+		}
+	}
+}
+
+/*
+ * Whether an event may have changed the lease file. A queue overflow
+ * matches every watch since events were lost.
+ */
+int lease_watch_match(const struct lease_watch *lw, const struct inotify_event *ev)
+{
+	if (ev->mask & IN_Q_OVERFLOW)
+		return 1;
+	if (lw->wd < 0 || ev->wd != lw->wd || !ev->len)
+		return 0;
+	return !strcmp(ev->name, lw->name);
+}
+
+/* Read the whole file into the reusable buffer, terminated by a newline */
+static ssize_t lease_read(struct lease_watch *lw)
+{
+	struct stat st;
+	size_t len = 0;
+	ssize_t n;
+	char *buf;
+	int fd;
+
+	fd = open(lw->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -errno;
+	}
+
+	if ((size_t)st.st_size + 2 > lw->size) {
+		buf = realloc(lw->buf, st.st_size + 2);
+		if (!buf) {
+			close(fd);
+			return -ENOMEM;
+		}
+		lw->buf = buf;
+		lw->size = st.st_size + 2;
+	}
+
+	/* The file may grow while it is read, stop at the buffer size */
+	while (len < lw->size - 1) {
+		n = read(fd, lw->buf + len, lw->size - 1 - len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+	}
+	close(fd);
+
+	lw->buf[len] = '\n';
+	return len;
+}
+
+static inline const char *next_field(const char **p, const char *end, size_t *len)
+{
+	const char *s = *p, *e;
+
+	while (s < end && *s == ' ')
+		s++;
+	for (e = s; e < end && *e != ' ' && *e != '\n'; e++)
+		;
+	*len = e - s;
+	*p = e;
+	return s;
+}
+
+/*
+ * Parse the lease file in one pass over a single read of it, and update
+ * the ip address of the known stations whose lease differs.
+ * Lines are "<expiry> <mac> <ip> <hostname> <client-id>", fields are used
+ * in place without copying them out of the buffer.
+ * Returns the number of stations updated, or a negative error code.
+ */
+int lease_watch_parse(struct lease_watch *lw, struct station_table *stations)
+{
+	const char *p, *end, *mac, *ip, *nl;
+	unsigned char addr[ETH_ALEN];
+	struct station_info *sta;
+	size_t mac_len, ip_len, skip;
+	ssize_t len;
+	int changed = 0;
+
+	len = lease_read(lw);
+	if (len < 0)
+		return len;
+
+	p = lw->buf;
+	end = lw->buf + len;
+	while (p < end) {
+		nl = memchr(p, '\n', end + 1 - p);
+
+		next_field(&p, nl, &skip);
+		mac = next_field(&p, nl, &mac_len);
+		ip = next_field(&p, nl, &ip_len);
+		p = nl + 1;
+
+		if (!ip_len || ip_len >= IP_ADDRESS_BUFFER_LEN)
+			continue;
+		if (mac_addr_a2n(addr, mac, mac_len))
+			continue;
+
+		sta = station_table_lookup(stations, addr);
+		if (!sta)
+			continue;
+		if (!strncmp(sta->ip, ip, ip_len) && sta->ip[ip_len] == '\0')
+			continue;
+
+		memcpy(sta->ip, ip, ip_len);
+		sta->ip[ip_len] = '\0';
+		changed++;
+	}
+
+	return changed;
+}
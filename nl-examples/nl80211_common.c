@@ -0,0 +1,245 @@
+/*   Common nl80211 socket and request helpers
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/family.h>
+#include <netlink/genl/ctrl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/genetlink.h>
+
+#include "nl80211_common.h"
+#include "nl80211.h"
+#include "genl.h"
+
+int nl80211_init(struct nl80211_state *nlstate)
+{
+	int err;
+
+	nlstate->nl_sock = nl_socket_alloc();
+	if (!nlstate->nl_sock) {
+		fprintf(stderr, "Failed to allocate netlink socket.\n");
+		return -ENOMEM;
+	}
+
+	if (genl_connect(nlstate->nl_sock)) {
+		fprintf(stderr, "Failed to connect to generic netlink.\n");
+		err = -ENOLINK;
+		goto out_handle_destroy;
+	}
+
+	nl_socket_set_buffer_size(nlstate->nl_sock, 8192, 8192);
+
+	/* try to set NETLINK_EXT_ACK to 1, ignoring errors */
+	err = 1;
+	setsockopt(nl_socket_get_fd(nlstate->nl_sock), SOL_NETLINK,
+		   NETLINK_EXT_ACK, &err, sizeof(err));
+
+	nlstate->nl80211_id = genl_resolve_family(nlstate->nl_sock, "nl80211");
+	if (nlstate->nl80211_id < 0) {
+		fprintf(stderr, "nl80211 not found.\n");
+		err = -ENOENT;
+		goto out_handle_destroy;
+	}
+
+	return 0;
+
+ out_handle_destroy:
+	nl_socket_free(nlstate->nl_sock);
+	nlstate->nl_sock = NULL;
+	return err;
+}
+
+void nl80211_cleanup(struct nl80211_state *nlstate)
+{
+	if (nlstate->nl_sock)
+		nl_socket_free(nlstate->nl_sock);
+	nlstate->nl_sock = NULL;
+}
+
+/*
+ * Size the socket buffers of an event socket, 8192 bytes are easily
+ * overrun when many events arrive at once. Going past net.core.rmem_max
+ * requires CAP_NET_ADMIN, without it the receive buffer is capped there.
+ */
+int nl80211_set_buffer_size(struct nl80211_state *nlstate, int rxbuf, int txbuf)
+{
+	int err;
+
+	err = nl_socket_set_buffer_size(nlstate->nl_sock, rxbuf, txbuf);
+	if (err < 0)
+		return err;
+
+	/* ignore errors, the capped size is already in place */
+	setsockopt(nl_socket_get_fd(nlstate->nl_sock), SOL_SOCKET,
+		   SO_RCVBUFFORCE, &rxbuf, sizeof(rxbuf));
+
+	return 0;
+}
+
+static int no_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+/*
+ * Turn nlstate into a non-blocking event socket and allocate the callback
+ * set that passes every event to handler. Release it with nl_cb_put().
+ */
+struct nl_cb *nl80211_event_cb_alloc(struct nl80211_state *nlstate,
+				     int (*handler)(struct nl_msg *, void *), void *arg)
+{
+	struct nl_cb *cb;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		return NULL;
+
+	/* no sequence checking for multicast messages */
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, no_seq_check, NULL);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, handler, arg);
+	nl_socket_set_nonblocking(nlstate->nl_sock);
+
+	return cb;
+}
+
+/*
+ * Process every pending event of an event socket without blocking. An
+ * overrun of the receive buffer shows up as ENOBUFS, reported by libnl as
+ * NLE_NOMEM; the events queued after it are still processed.
+ * Returns 1 if events were lost, 0 if not, or a negative error code.
+ */
+int nl80211_event_drain(struct nl80211_state *nlstate, struct nl_cb *cb)
+{
+	int err, overrun = 0;
+
+	while ((err = nl_recvmsgs_report(nlstate->nl_sock, cb)) != 0) {
+		if (err == -NLE_NOMEM)
+			overrun = 1;
+		else if (err < 0)
+			return err;
+	}
+
+	return overrun;
+}
+
+struct nl_msg *nl80211_msg_alloc(struct nl80211_state *nlstate, int cmd, int flags)
+{
+	struct nl_msg *msg = nlmsg_alloc();
+
+	if (!msg)
+		return NULL;
+
+	if (!genlmsg_put(msg, 0, 0, nlstate->nl80211_id, 0, flags, cmd, 0)) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+
+	return msg;
+}
+
+static int error_handler(struct sockaddr_nl *nla, struct nlmsgerr *err,
+			 void *arg)
+{
+	int *ret = arg;
+	*ret = err->error;
+	return NL_STOP;
+}
+
+static int finish_handler(struct nl_msg *msg, void *arg)
+{
+	int *ret = arg;
+	*ret = 0;
+	return NL_SKIP;
+}
+
+static int ack_handler(struct nl_msg *msg, void *arg)
+{
+	int *ret = arg;
+	*ret = 0;
+	return NL_STOP;
+}
+
+/*
+ * Send a request and process its replies until it is acknowledged, finished
+ * or fails. The message is always freed.
+ */
+int nl80211_send_and_recv(struct nl80211_state *nlstate, struct nl_msg *msg,
+			  int (*valid_handler)(struct nl_msg *, void *),
+			  void *valid_data)
+{
+	struct nl_cb *cb;
+	int err;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = nl_send_auto_complete(nlstate->nl_sock, msg);
+	if (err < 0)
+		goto out;
+
+	err = 1;
+
+	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &err);
+	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, finish_handler, &err);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &err);
+	if (valid_handler)
+		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, valid_handler, valid_data);
+
+	while (err > 0)
+		nl_recvmsgs(nlstate->nl_sock, cb);
+
+ out:
+	nl_cb_put(cb);
+	nlmsg_free(msg);
+	return err;
+}
+
+/* Parse the top level attributes of an nl80211 message */
+int nl80211_parse(struct nl_msg *msg, struct nlattr **tb)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+
+	return nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+			 genlmsg_attrlen(gnlh, 0), NULL);
+}
+
+/* Value of an optional u32 attribute, 0 if absent */
+unsigned int nl80211_get_u32(struct nlattr *attr)
+{
+	return attr ? nla_get_u32(attr) : 0;
+}
+
+/* Bitrate of a nested rate info attribute in units of 100 kbit/s, 0 if absent */
+unsigned int nl80211_parse_bitrate(struct nlattr *attr)
+{
+	struct nlattr *rinfo[NL80211_RATE_INFO_MAX + 1];
+
+	if (!attr || nla_parse_nested(rinfo, NL80211_RATE_INFO_MAX, attr, NULL))
+		return 0;
+
+	if (rinfo[NL80211_RATE_INFO_BITRATE32])
+		return nla_get_u32(rinfo[NL80211_RATE_INFO_BITRATE32]);
+	if (rinfo[NL80211_RATE_INFO_BITRATE])
+		return nla_get_u16(rinfo[NL80211_RATE_INFO_BITRATE]);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*   Connection quality monitor: RSSI thresholds and beacon loss notifications
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "genl.h"
+#include "nl80211.h"
+#include "nl80211_cqm.h"
+
+/*
+ * Configure the RSSI thresholds of an interface, in dBm. With a single
+ * threshold, hysteresis avoids repeated events around it. Drivers that
+ * support a list of thresholds report every crossing of any of them.
+ * No threshold disables RSSI monitoring.
+ */
+int nl80211_cqm_set_rssi(struct nl80211_state *nlstate, int ifindex,
+			 const int *thresholds, int n_thresholds, unsigned int hysteresis)
+{
+	struct nl_msg *msg;
+	struct nlattr *cqm;
+	int off = 0;
+
+	if (n_thresholds < 0 || n_thresholds > NL80211_CQM_MAX_THRESHOLDS)
+		return -EINVAL;
+
+	if (!n_thresholds) {
+		thresholds = &off;
+		n_thresholds = 1;
+		hysteresis = 0;
+	}
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_SET_CQM, 0);
+	if (!msg)
+		return -ENOMEM;
+
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+
+	cqm = nla_nest_start(msg, NL80211_ATTR_CQM);
+	if (!cqm)
+		goto nla_put_failure;
+	NLA_PUT(msg, NL80211_ATTR_CQM_RSSI_THOLD,
+		n_thresholds * sizeof(*thresholds), thresholds);
+	NLA_PUT_U32(msg, NL80211_ATTR_CQM_RSSI_HYST, hysteresis);
+	nla_nest_end(msg, cqm);
+
+	return nl80211_send_and_recv(nlstate, msg, NULL, NULL);
+
+ nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+static int cqm_event_handler(struct nl_msg *msg, void *arg)
+{
+	struct nl80211_cqm_monitor *mon = arg;
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *cqm[NL80211_ATTR_CQM_MAX + 1];
+	struct nl80211_cqm_event ev;
+
+	if (gnlh->cmd != NL80211_CMD_NOTIFY_CQM)
+		return NL_SKIP;
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_IFINDEX] || !tb[NL80211_ATTR_CQM])
+		return NL_SKIP;
+
+	if (nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != mon->ifindex)
+		return NL_SKIP;
+
+	if (nla_parse_nested(cqm, NL80211_ATTR_CQM_MAX, tb[NL80211_ATTR_CQM], NULL))
+		return NL_SKIP;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.ifindex = mon->ifindex;
+	if (cqm[NL80211_ATTR_CQM_RSSI_LEVEL])
+		ev.rssi = (int)nla_get_u32(cqm[NL80211_ATTR_CQM_RSSI_LEVEL]);
+
+	if (cqm[NL80211_ATTR_CQM_RSSI_THRESHOLD_EVENT]) {
+		switch (nla_get_u32(cqm[NL80211_ATTR_CQM_RSSI_THRESHOLD_EVENT])) {
+		case NL80211_CQM_RSSI_THRESHOLD_EVENT_LOW:
+			ev.type = NL80211_CQM_EVENT_RSSI_LOW;
+			break;
+		case NL80211_CQM_RSSI_THRESHOLD_EVENT_HIGH:
+			ev.type = NL80211_CQM_EVENT_RSSI_HIGH;
+			break;
+		case NL80211_CQM_RSSI_BEACON_LOSS_EVENT:
+			ev.type = NL80211_CQM_EVENT_BEACON_LOSS;
+			break;
+		default:
+			return NL_SKIP;
+		}
+	} else if (cqm[NL80211_ATTR_CQM_BEACON_LOSS_EVENT]) {
+		ev.type = NL80211_CQM_EVENT_BEACON_LOSS;
+	} else if (cqm[NL80211_ATTR_CQM_PKT_LOSS_EVENT]) {
+		ev.type = NL80211_CQM_EVENT_PACKET_LOSS;
+		ev.packets = nla_get_u32(cqm[NL80211_ATTR_CQM_PKT_LOSS_EVENT]);
+	} else {
+		return NL_SKIP;
+	}
+
+	mon->callback(&ev, mon->user_data);
+	return NL_SKIP;
+}
+
+/*
+ * Open the notification socket of an interface and join the mlme group,
+ * which carries NL80211_CMD_NOTIFY_CQM.
+ */
+int nl80211_cqm_monitor_init(struct nl80211_cqm_monitor *mon, int ifindex,
+			     nl80211_cqm_callback callback, void *user_data)
+{
+	int mcid, err;
+
+	memset(mon, 0, sizeof(*mon));
+	mon->ifindex = ifindex;
+	mon->callback = callback;
+	mon->user_data = user_data;
+
+	err = nl80211_init(&mon->nlstate);
+	if (err)
+		return err;
+
+	mcid = nl_get_multicast_id(mon->nlstate.nl_sock, "nl80211", "mlme");
+	if (mcid < 0) {
+		err = mcid;
+		goto out_close;
+	}
+
+	err = nl_socket_add_membership(mon->nlstate.nl_sock, mcid);
+	if (err)
+		goto out_close;
+
+	mon->cb = nl80211_event_cb_alloc(&mon->nlstate, cqm_event_handler, mon);
+	if (!mon->cb) {
+		err = -ENOMEM;
+		goto out_close;
+	}
+
+	return 0;
+
+ out_close:
+	nl80211_cqm_monitor_close(mon);
+	return err;
+}
+
+void nl80211_cqm_monitor_close(struct nl80211_cqm_monitor *mon)
+{
+	if (mon->cb)
+		nl_cb_put(mon->cb);
+	mon->cb = NULL;
+	nl80211_cleanup(&mon->nlstate);
+}
+
+int nl80211_cqm_monitor_get_fd(struct nl80211_cqm_monitor *mon)
+{
+	return nl_socket_get_fd(mon->nlstate.nl_sock);
+}
+
+/*
+ * Process every pending notification, calling the callback of the
+ * monitor for each CQM event of its interface. Never blocks.
+ * Returns 1 if notifications were lost, 0 if not, or a negative error code.
+ */
+int nl80211_cqm_monitor_dispatch(struct nl80211_cqm_monitor *mon)
+{
+	return nl80211_event_drain(&mon->nlstate, mon->cb);
+}
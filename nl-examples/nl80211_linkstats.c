@@ -0,0 +1,376 @@
+/*   Link statistics sampler: per-second rates and moving averages of the
+     station entry of the associated BSS
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "nl80211.h"
+#include "nl80211_linkstats.h"
+
+struct linkstats_args
+{
+	struct nl80211_linkstats_counters *counters;
+	unsigned char *bssid;
+	int found;
+};
+
+static inline int get_dbm(struct nlattr *attr)
+{
+	return attr ? (signed char)nla_get_u8(attr) : 0;
+}
+
+static int station_handler(struct nl_msg *msg, void *arg)
+{
+	struct linkstats_args *args = arg;
+	struct nl80211_linkstats_counters *c = args->counters;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *sinfo[NL80211_STA_INFO_MAX + 1];
+
+	/* A managed interface has a single station entry, its BSS */
+	if (args->found)
+		return NL_SKIP;
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_MAC] || !tb[NL80211_ATTR_STA_INFO])
+		return NL_SKIP;
+
+	if (nla_parse_nested(sinfo, NL80211_STA_INFO_MAX, tb[NL80211_ATTR_STA_INFO], NULL))
+		return NL_SKIP;
+
+	args->found = 1;
+	if (args->bssid)
+		memcpy(args->bssid, nla_data(tb[NL80211_ATTR_MAC]), ETH_ALEN);
+
+	memset(c, 0, sizeof(*c));
+	if (sinfo[NL80211_STA_INFO_RX_BYTES64]) {
+		c->rx_bytes = nla_get_u64(sinfo[NL80211_STA_INFO_RX_BYTES64]);
+	} else {
+		c->rx_bytes = nl80211_get_u32(sinfo[NL80211_STA_INFO_RX_BYTES]);
+		c->rx_bytes32 = 1;
+	}
+
+	if (sinfo[NL80211_STA_INFO_TX_BYTES64]) {
+		c->tx_bytes = nla_get_u64(sinfo[NL80211_STA_INFO_TX_BYTES64]);
+	} else {
+		c->tx_bytes = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_BYTES]);
+		c->tx_bytes32 = 1;
+	}
+
+	c->rx_packets = nl80211_get_u32(sinfo[NL80211_STA_INFO_RX_PACKETS]);
+	c->tx_packets = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_PACKETS]);
+	c->tx_retries = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_RETRIES]);
+	c->tx_failed = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_FAILED]);
+	c->beacon_loss = nl80211_get_u32(sinfo[NL80211_STA_INFO_BEACON_LOSS]);
+	c->connected_time = nl80211_get_u32(sinfo[NL80211_STA_INFO_CONNECTED_TIME]);
+	c->tx_bitrate = nl80211_parse_bitrate(sinfo[NL80211_STA_INFO_TX_BITRATE]);
+	c->rx_bitrate = nl80211_parse_bitrate(sinfo[NL80211_STA_INFO_RX_BITRATE]);
+	c->signal = get_dbm(sinfo[NL80211_STA_INFO_SIGNAL]);
+	c->signal_avg = get_dbm(sinfo[NL80211_STA_INFO_SIGNAL_AVG]);
+
+	return NL_SKIP;
+}
+
+/*
+ * Read the station entry of bssid, or when bssid is NULL the first entry
+ * of the interface, storing its address in found_bssid.
+ */
+static int station_get(struct nl80211_state *nlstate, int ifindex,
+		       const unsigned char *bssid, unsigned char *found_bssid,
+		       struct nl80211_linkstats_counters *counters)
+{
+	struct linkstats_args args = {
+		.counters = counters,
+		.bssid = found_bssid,
+	};
+	struct nl_msg *msg;
+	int err;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_GET_STATION, bssid ? 0 : NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+	if (bssid)
+		NLA_PUT(msg, NL80211_ATTR_MAC, ETH_ALEN, bssid);
+
+	err = nl80211_send_and_recv(nlstate, msg, station_handler, &args);
+	if (err < 0)
+		return err;
+
+	return args.found ? 0 : -ENOTCONN;
+
+ nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+/*
+ * Read the counters of the station entry of a BSS.
+ * Returns -ENOENT when the interface is no longer associated with it.
+ */
+int nl80211_linkstats_get(struct nl80211_state *nlstate, int ifindex,
+			  const unsigned char *bssid,
+			  struct nl80211_linkstats_counters *counters)
+{
+	return station_get(nlstate, ifindex, bssid, NULL, counters);
+}
+
+/*
+ * Create the sampler of an interface and arm its timer. weight is the
+ * percentage of the newest sample in the moving averages, out of range
+ * values select NL80211_LINKSTATS_DEFAULT_WEIGHT.
+ */
+int nl80211_linkstats_init(struct nl80211_linkstats *ls, int ifindex,
+			   int interval_ms, int weight)
+{
+	struct itimerspec its;
+
+	memset(ls, 0, sizeof(*ls));
+	ls->tfd = -1;
+	if (interval_ms <= 0)
+		return -EINVAL;
+
+	ls->ifindex = ifindex;
+	ls->weight = weight > 0 && weight <= 100 ? weight : NL80211_LINKSTATS_DEFAULT_WEIGHT;
+
+	ls->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (ls->tfd < 0)
+		return -errno;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = interval_ms / 1000;
+	its.it_value.tv_nsec = (interval_ms % 1000) * 1000000;
+	its.it_interval = its.it_value;
+	if (timerfd_settime(ls->tfd, 0, &its, NULL)) {
+		close(ls->tfd);
+		ls->tfd = -1;
+		return -errno;
+	}
+
+	return 0;
+}
+
+void nl80211_linkstats_close(struct nl80211_linkstats *ls)
+{
+	if (ls->tfd >= 0)
+		close(ls->tfd);
+	ls->tfd = -1;
+}
+
+int nl80211_linkstats_get_fd(struct nl80211_linkstats *ls)
+{
+	return ls->tfd;
+}
+
+/*
+ * Take a sample if the timer expired. Never blocks.
+ * Returns 1 if a sample was taken, 0 if the timer did not expire, or a
+ * negative error code.
+ */
+int nl80211_linkstats_dispatch(struct nl80211_state *nlstate, struct nl80211_linkstats *ls)
+{
+	uint64_t expirations;
+	int err;
+
+	if (read(ls->tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return errno == EAGAIN ? 0 : -errno;
+
+	err = nl80211_linkstats_sample(nlstate, ls);
+	return err < 0 ? err : 1;
+}
+
+static unsigned long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Rates of a set of deltas accumulated over time_ms. Bitrates and signal
+ * are averaged over the n deltas.
+ */
+static void rates_compute(const struct nl80211_linkstats_delta *sum, unsigned long long time_ms,
+			  int n, struct nl80211_linkstats_rates *rates)
+{
+	double secs = time_ms / 1000.0;
+
+	rates->rx_bytes = sum->rx_bytes / secs;
+	rates->tx_bytes = sum->tx_bytes / secs;
+	rates->rx_packets = sum->rx_packets / secs;
+	rates->tx_packets = sum->tx_packets / secs;
+	rates->tx_retries = sum->tx_retries / secs;
+	rates->tx_failed = sum->tx_failed / secs;
+	rates->beacon_loss = sum->beacon_loss / secs;
+	rates->retry_ratio = sum->tx_packets ? (double)sum->tx_retries / sum->tx_packets : 0;
+	rates->tx_bitrate = sum->tx_bitrate * 100.0 / n;
+	rates->rx_bitrate = sum->rx_bitrate * 100.0 / n;
+	rates->signal_avg = (double)sum->signal_avg / n;
+}
+
+static void ewma_update(struct nl80211_linkstats *ls, const struct nl80211_linkstats_delta *d)
+{
+	struct nl80211_linkstats_rates cur;
+	double w = ls->weight / 100.0;
+
+	if (!d->interval_ms)
+		return;
+
+	rates_compute(d, d->interval_ms, 1, &cur);
+	if (!ls->has_ewma) {
+		ls->ewma = cur;
+		ls->has_ewma = 1;
+		return;
+	}
+
+#define EWMA(field) ls->ewma.field += w * (cur.field - ls->ewma.field)
+	EWMA(rx_bytes);
+	EWMA(tx_bytes);
+	EWMA(rx_packets);
+	EWMA(tx_packets);
+	EWMA(tx_retries);
+	EWMA(tx_failed);
+	EWMA(beacon_loss);
+	EWMA(retry_ratio);
+	EWMA(tx_bitrate);
+	EWMA(rx_bitrate);
+	EWMA(signal_avg);
+#undef EWMA
+}
+
+/* Byte counters wrap at the width the driver reported them with */
+static inline unsigned long long bytes_delta(unsigned long long cur, unsigned long long last,
+					     int bytes32)
+{
+	return bytes32 ? (uint32_t)(cur - last) : cur - last;
+}
+
+/*
+ * Push the increments since the previous sample into the ring. The 32 bit
+ * counters wrap, so their increments are taken modulo 2^32.
+ */
+static void link_update(struct nl80211_linkstats *ls, const struct nl80211_linkstats_counters *c,
+			unsigned long long ms)
+{
+	struct nl80211_linkstats_delta *d = &ls->ring[ls->head];
+
+	d->interval_ms = ms - ls->last_ms;
+	d->rx_bytes = bytes_delta(c->rx_bytes, ls->last.rx_bytes, c->rx_bytes32);
+	d->tx_bytes = bytes_delta(c->tx_bytes, ls->last.tx_bytes, c->tx_bytes32);
+	d->rx_packets = c->rx_packets - ls->last.rx_packets;
+	d->tx_packets = c->tx_packets - ls->last.tx_packets;
+	d->tx_retries = c->tx_retries - ls->last.tx_retries;
+	d->tx_failed = c->tx_failed - ls->last.tx_failed;
+	d->beacon_loss = c->beacon_loss - ls->last.beacon_loss;
+	d->tx_bitrate = c->tx_bitrate;
+	d->rx_bitrate = c->rx_bitrate;
+	d->signal_avg = c->signal_avg ? c->signal_avg : c->signal;
+
+	ls->head = (ls->head + 1) % NL80211_LINKSTATS_RING_SIZE;
+	if (ls->count < NL80211_LINKSTATS_RING_SIZE)
+		ls->count++;
+
+	ewma_update(ls, d);
+}
+
+/*
+ * Take one sample of the station entry of the associated BSS. The BSS is
+ * looked up again after a roam or a disconnection, and the counters of a
+ * new association only serve as the reference of the next sample.
+ * Returns 1 if a delta was pushed into the ring, 0 for a reference sample,
+ * -ENOTCONN when the interface is not associated, or a negative error code.
+ */
+int nl80211_linkstats_sample(struct nl80211_state *nlstate, struct nl80211_linkstats *ls)
+{
+	struct nl80211_linkstats_counters c;
+	unsigned long long ms;
+	int err = -ENOENT, pushed = 0;
+
+	if (ls->associated)
+		err = nl80211_linkstats_get(nlstate, ls->ifindex, ls->bssid, &c);
+
+	if (err == -ENOENT) {
+		ls->associated = 0;
+		ls->has_last = 0;
+		err = station_get(nlstate, ls->ifindex, NULL, ls->bssid, &c);
+		if (err)
+			return err;
+		ls->associated = 1;
+	} else if (err) {
+		return err;
+	}
+
+	ms = now_ms();
+
+	/* A shorter connection means the counters restarted with a new association */
+	if (ls->has_last && c.connected_time >= ls->last.connected_time) {
+		link_update(ls, &c, ms);
+		pushed = 1;
+	}
+
+	ls->last = c;
+	ls->last_ms = ms;
+	ls->has_last = 1;
+
+	return pushed;
+}
+
+/*
+ * Rates over the last window samples, the whole ring when window is 0.
+ * Returns -ENODATA until a sample covers some time.
+ */
+int nl80211_linkstats_rates(const struct nl80211_linkstats *ls, int window,
+			    struct nl80211_linkstats_rates *rates)
+{
+	const struct nl80211_linkstats_delta *d;
+	struct nl80211_linkstats_delta sum;
+	unsigned long long time = 0;
+	int i;
+
+	if (window <= 0 || window > ls->count)
+		window = ls->count;
+
+	memset(&sum, 0, sizeof(sum));
+	for (i = 1; i <= window; i++) {
+		d = &ls->ring[(ls->head - i + NL80211_LINKSTATS_RING_SIZE) % NL80211_LINKSTATS_RING_SIZE];
+		time += d->interval_ms;
+		sum.rx_bytes += d->rx_bytes;
+		sum.tx_bytes += d->tx_bytes;
+		sum.rx_packets += d->rx_packets;
+		sum.tx_packets += d->tx_packets;
+		sum.tx_retries += d->tx_retries;
+		sum.tx_failed += d->tx_failed;
+		sum.beacon_loss += d->beacon_loss;
+		sum.tx_bitrate += d->tx_bitrate;
+		sum.rx_bitrate += d->rx_bitrate;
+		sum.signal_avg += d->signal_avg;
+	}
+
+	if (!time)
+		return -ENODATA;
+
+	rates_compute(&sum, time, window, rates);
+	return 0;
+}
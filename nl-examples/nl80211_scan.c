@@ -0,0 +1,276 @@
+/*   Scan engine: trigger a scan, wait for its completion and dump the BSSes
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/family.h>
+#include <netlink/genl/ctrl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/genetlink.h>
+
+#include "genl.h"
+#include "nl80211.h"
+#include "nl80211_scan.h"
+
+#define WLAN_EID_SSID 0
+
+int nl80211_scan_trigger(struct nl80211_state *nlstate, int ifindex,
+			 const struct nl80211_scan_params *params)
+{
+	struct nl_msg *msg;
+	struct nlattr *nest;
+	int i;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_TRIGGER_SCAN, 0);
+	if (!msg)
+		return -ENOMEM;
+
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+
+	if (!params->passive) {
+		nest = nla_nest_start(msg, NL80211_ATTR_SCAN_SSIDS);
+		if (!nest)
+			goto nla_put_failure;
+		if (!params->n_ssids)
+			NLA_PUT(msg, 1, 0, "");
+		for (i = 0; i < params->n_ssids; i++)
+			NLA_PUT(msg, i + 1, strnlen(params->ssids[i], NL80211_SCAN_MAX_SSID_LEN),
+				params->ssids[i]);
+		nla_nest_end(msg, nest);
+	}
+
+	if (params->n_freqs) {
+		nest = nla_nest_start(msg, NL80211_ATTR_SCAN_FREQUENCIES);
+		if (!nest)
+			goto nla_put_failure;
+		for (i = 0; i < params->n_freqs; i++)
+			NLA_PUT_U32(msg, i + 1, params->freqs[i]);
+		nla_nest_end(msg, nest);
+	}
+
+	return nl80211_send_and_recv(nlstate, msg, NULL, NULL);
+
+ nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+struct scan_dump_args
+{
+	struct nl80211_scan_bss *bss;
+	int size;
+	int num;
+	int total;
+};
+
+static void parse_ssid(const unsigned char *ie, int len, struct nl80211_scan_bss *bss)
+{
+	while (len >= 2 && len >= ie[1] + 2) {
+		if (ie[0] == WLAN_EID_SSID) {
+			bss->ssid_len = ie[1] > NL80211_SCAN_MAX_SSID_LEN ?
+					NL80211_SCAN_MAX_SSID_LEN : ie[1];
+			memcpy(bss->ssid, ie + 2, bss->ssid_len);
+			return;
+		}
+		len -= ie[1] + 2;
+		ie += ie[1] + 2;
+	}
+}
+
+static int scan_dump_handler(struct nl_msg *msg, void *arg)
+{
+	struct scan_dump_args *args = arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *attr[NL80211_BSS_MAX + 1];
+	struct nlattr *ies;
+	struct nl80211_scan_bss *bss;
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_BSS])
+		return NL_SKIP;
+
+	if (nla_parse_nested(attr, NL80211_BSS_MAX, tb[NL80211_ATTR_BSS], NULL))
+		return NL_SKIP;
+
+	if (!attr[NL80211_BSS_BSSID])
+		return NL_SKIP;
+
+	/* Keep counting once the array is full so callers learn the real size */
+	if (args->total++ >= args->size)
+		return NL_SKIP;
+
+	bss = &args->bss[args->num++];
+	memset(bss, 0, sizeof(*bss));
+	memcpy(bss->bssid, nla_data(attr[NL80211_BSS_BSSID]), ETH_ALEN);
+
+	if (attr[NL80211_BSS_FREQUENCY])
+		bss->freq = nla_get_u32(attr[NL80211_BSS_FREQUENCY]);
+	if (attr[NL80211_BSS_SIGNAL_MBM])
+		bss->signal_mbm = (int)nla_get_u32(attr[NL80211_BSS_SIGNAL_MBM]);
+	if (attr[NL80211_BSS_SEEN_MS_AGO])
+		bss->seen_ms_ago = nla_get_u32(attr[NL80211_BSS_SEEN_MS_AGO]);
+	if (attr[NL80211_BSS_CAPABILITY])
+		bss->capability = nla_get_u16(attr[NL80211_BSS_CAPABILITY]);
+	if (attr[NL80211_BSS_BEACON_INTERVAL])
+		bss->beacon_interval = nla_get_u16(attr[NL80211_BSS_BEACON_INTERVAL]);
+	if (attr[NL80211_BSS_STATUS])
+		bss->associated = nla_get_u32(attr[NL80211_BSS_STATUS]) == NL80211_BSS_STATUS_ASSOCIATED;
+
+	ies = attr[NL80211_BSS_INFORMATION_ELEMENTS];
+	if (!ies)
+		ies = attr[NL80211_BSS_BEACON_IES];
+	if (ies)
+		parse_ssid(nla_data(ies), nla_len(ies), bss);
+
+	return NL_SKIP;
+}
+
+/*
+ * Dump the scan results of an interface into bss. Returns the number of
+ * entries stored, total is set to the number of BSSes reported.
+ */
+int nl80211_scan_dump(struct nl80211_state *nlstate, int ifindex,
+		      struct nl80211_scan_bss *bss, int size, int *total)
+{
+	struct scan_dump_args args = { .bss = bss, .size = size };
+	struct nl_msg *msg;
+	int err;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_GET_SCAN, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	if (nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifindex) < 0) {
+		nlmsg_free(msg);
+		return -ENOBUFS;
+	}
+
+	err = nl80211_send_and_recv(nlstate, msg, scan_dump_handler, &args);
+	if (err < 0)
+		return err;
+
+	if (total)
+		*total = args.total;
+	return args.num;
+}
+
+struct scan_wait_args
+{
+	int ifindex;
+	int done;
+};
+
+static int scan_event_handler(struct nl_msg *msg, void *arg)
+{
+	struct scan_wait_args *args = arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_IFINDEX] ||
+	    (int)nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != args->ifindex)
+		return NL_SKIP;
+
+	if (gnlh->cmd == NL80211_CMD_NEW_SCAN_RESULTS)
+		args->done = 1;
+	else if (gnlh->cmd == NL80211_CMD_SCAN_ABORTED)
+		args->done = -ECANCELED;
+
+	return NL_SKIP;
+}
+
+static long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Trigger a scan and wait for it to complete before dumping its results.
+ * The scan multicast group is joined on a separate socket before the
+ * trigger, so the completion event cannot be missed.
+ */
+int nl80211_scan(struct nl80211_state *nlstate, int ifindex,
+		 const struct nl80211_scan_params *params, int timeout_ms,
+		 struct nl80211_scan_bss *bss, int size, int *total)
+{
+	struct scan_wait_args args = { .ifindex = ifindex };
+	struct nl80211_state events = { NULL, 0 };
+	struct nl_cb *cb = NULL;
+	struct pollfd pfd;
+	long long deadline;
+	int mcid, err, left;
+
+	err = nl80211_init(&events);
+	if (err)
+		return err;
+
+	mcid = nl_get_multicast_id(events.nl_sock, "nl80211", "scan");
+	if (mcid < 0) {
+		err = mcid;
+		goto out;
+	}
+
+	err = nl_socket_add_membership(events.nl_sock, mcid);
+	if (err)
+		goto out;
+
+	cb = nl80211_event_cb_alloc(&events, scan_event_handler, &args);
+	if (!cb) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = nl80211_scan_trigger(nlstate, ifindex, params);
+	if (err)
+		goto out;
+
+	pfd.fd = nl_socket_get_fd(events.nl_sock);
+	pfd.events = POLLIN;
+	deadline = now_ms() + (timeout_ms > 0 ? timeout_ms : NL80211_SCAN_TIMEOUT_MS);
+
+	while (!args.done) {
+		left = deadline - now_ms();
+		if (left <= 0) {
+			err = -ETIMEDOUT;
+			goto out;
+		}
+		if (poll(&pfd, 1, left) > 0) {
+			err = nl80211_event_drain(&events, cb);
+			if (err < 0)
+				goto out;
+		}
+	}
+
+	if (args.done < 0) {
+		err = args.done;
+		goto out;
+	}
+
+	err = nl80211_scan_dump(nlstate, ifindex, bss, size, total);
+
+ out:
+	nl_cb_put(cb);
+	nl80211_cleanup(&events);
+	return err;
+}
@@ -0,0 +1,168 @@
+/*   Station dump into a structure-of-arrays statistics table
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "nl80211.h"
+#include "nl80211_station.h"
+
+#define STATION_TABLE_DEFAULT_SIZE 16
+
+struct station_dump_args
+{
+	struct nl80211_station_table *table;
+	int err;
+};
+
+static int station_table_resize(struct nl80211_station_table *t, int size)
+{
+#define RESIZE(col) do { \
+		void *p = realloc(t->col, size * sizeof(*t->col)); \
+		if (!p) \
+			return -ENOMEM; \
+		t->col = p; \
+	} while (0)
+
+	RESIZE(mac);
+	RESIZE(signal);
+	RESIZE(inactive_ms);
+	RESIZE(rx_bytes);
+	RESIZE(tx_bytes);
+	RESIZE(rx_packets);
+	RESIZE(tx_packets);
+	RESIZE(tx_retries);
+	RESIZE(tx_failed);
+	RESIZE(tx_bitrate);
+	RESIZE(rx_bitrate);
+#undef RESIZE
+
+	t->size = size;
+	return 0;
+}
+
+int nl80211_station_table_init(struct nl80211_station_table *table, int size)
+{
+	memset(table, 0, sizeof(*table));
+	if (size <= 0)
+		size = STATION_TABLE_DEFAULT_SIZE;
+
+	if (station_table_resize(table, size)) {
+		nl80211_station_table_free(table);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void nl80211_station_table_free(struct nl80211_station_table *table)
+{
+	free(table->mac);
+	free(table->signal);
+	free(table->inactive_ms);
+	free(table->rx_bytes);
+	free(table->tx_bytes);
+	free(table->rx_packets);
+	free(table->tx_packets);
+	free(table->tx_retries);
+	free(table->tx_failed);
+	free(table->tx_bitrate);
+	free(table->rx_bitrate);
+	memset(table, 0, sizeof(*table));
+}
+
+static int station_dump_handler(struct nl_msg *msg, void *arg)
+{
+	struct station_dump_args *args = arg;
+	struct nl80211_station_table *t = args->table;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *sinfo[NL80211_STA_INFO_MAX + 1];
+	int i;
+
+	if (args->err)
+		return NL_SKIP;
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_MAC] || !tb[NL80211_ATTR_STA_INFO])
+		return NL_SKIP;
+
+	if (nla_parse_nested(sinfo, NL80211_STA_INFO_MAX, tb[NL80211_ATTR_STA_INFO], NULL))
+		return NL_SKIP;
+
+	if (t->num == t->size && station_table_resize(t, t->size * 2)) {
+		args->err = -ENOMEM;
+		return NL_SKIP;
+	}
+
+	i = t->num++;
+	memcpy(t->mac[i], nla_data(tb[NL80211_ATTR_MAC]), ETH_ALEN);
+	t->signal[i] = sinfo[NL80211_STA_INFO_SIGNAL] ?
+		(signed char)nla_get_u8(sinfo[NL80211_STA_INFO_SIGNAL]) : 0;
+	t->inactive_ms[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_INACTIVE_TIME]);
+
+	if (sinfo[NL80211_STA_INFO_RX_BYTES64])
+		t->rx_bytes[i] = nla_get_u64(sinfo[NL80211_STA_INFO_RX_BYTES64]);
+	else
+		t->rx_bytes[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_RX_BYTES]);
+
+	if (sinfo[NL80211_STA_INFO_TX_BYTES64])
+		t->tx_bytes[i] = nla_get_u64(sinfo[NL80211_STA_INFO_TX_BYTES64]);
+	else
+		t->tx_bytes[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_BYTES]);
+
+	t->rx_packets[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_RX_PACKETS]);
+	t->tx_packets[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_PACKETS]);
+	t->tx_retries[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_RETRIES]);
+	t->tx_failed[i] = nl80211_get_u32(sinfo[NL80211_STA_INFO_TX_FAILED]);
+	t->tx_bitrate[i] = nl80211_parse_bitrate(sinfo[NL80211_STA_INFO_TX_BITRATE]);
+	t->rx_bitrate[i] = nl80211_parse_bitrate(sinfo[NL80211_STA_INFO_RX_BITRATE]);
+
+	return NL_SKIP;
+}
+
+/*
+ * Replace the content of table with the stations of an interface.
+ * The table grows as needed, so it can be reused across samples without
+ * any allocation once it reached the station count. Fails with -ENOMEM if
+ * it cannot grow, the stations dumped so far are kept.
+ */
+int nl80211_station_dump(struct nl80211_state *nlstate, int ifindex,
+			 struct nl80211_station_table *table)
+{
+	struct station_dump_args args;
+	struct nl_msg *msg;
+	int err;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_GET_STATION, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	if (nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifindex) < 0) {
+		nlmsg_free(msg);
+		return -ENOBUFS;
+	}
+
+	table->num = 0;
+	args.table = table;
+	args.err = 0;
+	err = nl80211_send_and_recv(nlstate, msg, station_dump_handler, &args);
+	if (!err)
+		err = args.err;
+	return err;
+}
@@ -0,0 +1,213 @@
+/*   Channel survey sampler: per frequency counter deltas and utilization
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "nl80211.h"
+#include "nl80211_survey.h"
+
+struct survey_dump_args
+{
+	struct nl80211_survey_counters *info;
+	int size;
+	int num;
+};
+
+static inline unsigned long long get_time(struct nlattr *attr)
+{
+	return attr ? nla_get_u64(attr) : 0;
+}
+
+static int survey_dump_handler(struct nl_msg *msg, void *arg)
+{
+	struct survey_dump_args *args = arg;
+	struct nl80211_survey_counters *info;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *sinfo[NL80211_SURVEY_INFO_MAX + 1];
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_SURVEY_INFO])
+		return NL_SKIP;
+
+	if (nla_parse_nested(sinfo, NL80211_SURVEY_INFO_MAX,
+			     tb[NL80211_ATTR_SURVEY_INFO], NULL))
+		return NL_SKIP;
+
+	if (!sinfo[NL80211_SURVEY_INFO_FREQUENCY])
+		return NL_SKIP;
+
+	/* Keep counting past the end so the caller learns the total */
+	if (args->num++ >= args->size)
+		return NL_SKIP;
+
+	info = &args->info[args->num - 1];
+	memset(info, 0, sizeof(*info));
+	info->freq = nla_get_u32(sinfo[NL80211_SURVEY_INFO_FREQUENCY]);
+	if (sinfo[NL80211_SURVEY_INFO_NOISE])
+		info->noise = (signed char)nla_get_u8(sinfo[NL80211_SURVEY_INFO_NOISE]);
+	info->in_use = !!sinfo[NL80211_SURVEY_INFO_IN_USE];
+	info->time = get_time(sinfo[NL80211_SURVEY_INFO_TIME]);
+	info->time_busy = get_time(sinfo[NL80211_SURVEY_INFO_TIME_BUSY]);
+	info->time_rx = get_time(sinfo[NL80211_SURVEY_INFO_TIME_RX]);
+	info->time_tx = get_time(sinfo[NL80211_SURVEY_INFO_TIME_TX]);
+
+	return NL_SKIP;
+}
+
+/*
+ * Dump the survey counters of every frequency of an interface.
+ * Returns the number of entries stored in info, total receives the number
+ * of frequencies reported.
+ */
+int nl80211_survey_dump(struct nl80211_state *nlstate, int ifindex,
+			struct nl80211_survey_counters *info, int size, int *total)
+{
+	struct survey_dump_args args = {
+		.info = info,
+		.size = size,
+	};
+	struct nl_msg *msg;
+	int err;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_GET_SURVEY, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	if (nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifindex) < 0) {
+		nlmsg_free(msg);
+		return -ENOBUFS;
+	}
+
+	err = nl80211_send_and_recv(nlstate, msg, survey_dump_handler, &args);
+	if (err < 0)
+		return err;
+
+	if (total)
+		*total = args.num;
+	return args.num < size ? args.num : size;
+}
+
+void nl80211_survey_init(struct nl80211_survey *survey, int ifindex)
+{
+	memset(survey, 0, sizeof(*survey));
+	survey->ifindex = ifindex;
+}
+
+struct nl80211_survey_channel *nl80211_survey_channel(struct nl80211_survey *survey,
+						      unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < survey->n_channels; i++)
+		if (survey->channels[i].freq == freq)
+			return &survey->channels[i];
+	return NULL;
+}
+
+/*
+ * Counters normally only grow. A smaller value means the driver reset
+ * them, e.g. on a channel switch, the new value is then the increment.
+ */
+static inline unsigned long long counter_delta(unsigned long long cur,
+					       unsigned long long last)
+{
+	return cur >= last ? cur - last : cur;
+}
+
+static void channel_update(struct nl80211_survey_channel *ch,
+			   const struct nl80211_survey_counters *info)
+{
+	struct nl80211_survey_delta *d;
+
+	ch->in_use = info->in_use;
+
+	if (ch->has_last) {
+		d = &ch->ring[ch->head];
+		d->time = counter_delta(info->time, ch->last.time);
+		d->time_busy = counter_delta(info->time_busy, ch->last.time_busy);
+		d->time_rx = counter_delta(info->time_rx, ch->last.time_rx);
+		d->time_tx = counter_delta(info->time_tx, ch->last.time_tx);
+		d->noise = info->noise;
+
+		ch->head = (ch->head + 1) % NL80211_SURVEY_RING_SIZE;
+		if (ch->count < NL80211_SURVEY_RING_SIZE)
+			ch->count++;
+	}
+
+	ch->last = *info;
+	ch->has_last = 1;
+}
+
+/*
+ * Take one sample: dump the survey and push the increments since the
+ * previous sample into the ring of each channel.
+ * Returns the number of channels sampled, or a negative error code.
+ */
+int nl80211_survey_sample(struct nl80211_state *nlstate, struct nl80211_survey *survey)
+{
+	struct nl80211_survey_counters info[NL80211_SURVEY_MAX_CHANNELS];
+	struct nl80211_survey_channel *ch;
+	int num, i;
+
+	num = nl80211_survey_dump(nlstate, survey->ifindex, info,
+				  NL80211_SURVEY_MAX_CHANNELS, NULL);
+	if (num < 0)
+		return num;
+
+	for (i = 0; i < num; i++) {
+		ch = nl80211_survey_channel(survey, info[i].freq);
+		if (!ch) {
+			if (survey->n_channels == NL80211_SURVEY_MAX_CHANNELS)
+				continue;
+			ch = &survey->channels[survey->n_channels++];
+			memset(ch, 0, sizeof(*ch));
+			ch->freq = info[i].freq;
+		}
+		channel_update(ch, &info[i]);
+	}
+
+	return num;
+}
+
+/*
+ * Share of the time the channel was busy over the last window deltas,
+ * the whole ring when window is 0.
+ * Returns a percentage, or -1 when no time was accounted on the channel.
+ */
+int nl80211_survey_utilization(const struct nl80211_survey_channel *channel, int window)
+{
+	unsigned long long time = 0, busy = 0;
+	int i, idx;
+
+	if (window <= 0 || window > channel->count)
+		window = channel->count;
+
+	for (i = 1; i <= window; i++) {
+		idx = (channel->head - i + NL80211_SURVEY_RING_SIZE) % NL80211_SURVEY_RING_SIZE;
+		time += channel->ring[idx].time;
+		busy += channel->ring[idx].time_busy;
+	}
+
+	if (!time)
+		return -1;
+	if (busy > time)
+		busy = time;
+	return (int)(busy * 100 / time);
+}
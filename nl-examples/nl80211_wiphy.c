@@ -0,0 +1,407 @@
+/*   Wiphy capability cache built from a split NL80211_CMD_GET_WIPHY dump
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <asm/errno.h>
+#include <netlink/genl/genl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "genl.h"
+#include "nl80211.h"
+#include "nl80211_wiphy.h"
+
+struct wiphy_dump_args
+{
+	int n_wiphys;
+	struct nl80211_wiphy_caps *wiphys;
+	int err;
+};
+
+static struct nl80211_wiphy_caps *dump_get_wiphy(struct wiphy_dump_args *args, int wiphy)
+{
+	struct nl80211_wiphy_caps *caps;
+	int i;
+
+	/* A split dump sends the parts of a wiphy in a row, check the last first */
+	for (i = args->n_wiphys - 1; i >= 0; i--)
+		if (args->wiphys[i].wiphy == wiphy)
+			return &args->wiphys[i];
+
+	caps = realloc(args->wiphys, (args->n_wiphys + 1) * sizeof(*caps));
+	if (!caps)
+		return NULL;
+	args->wiphys = caps;
+
+	caps = &args->wiphys[args->n_wiphys++];
+	memset(caps, 0, sizeof(*caps));
+	caps->wiphy = wiphy;
+	return caps;
+}
+
+static int add_channel(struct nl80211_wiphy_caps *caps, int band, struct nlattr *attr)
+{
+	struct nlattr *tb[NL80211_FREQUENCY_ATTR_MAX + 1];
+	struct nl80211_wiphy_channel *ch;
+
+	if (nla_parse_nested(tb, NL80211_FREQUENCY_ATTR_MAX, attr, NULL))
+		return 0;
+	if (!tb[NL80211_FREQUENCY_ATTR_FREQ])
+		return 0;
+
+	ch = realloc(caps->channels, (caps->n_channels + 1) * sizeof(*ch));
+	if (!ch)
+		return -ENOMEM;
+	caps->channels = ch;
+
+	ch = &caps->channels[caps->n_channels++];
+	memset(ch, 0, sizeof(*ch));
+	ch->freq = nla_get_u32(tb[NL80211_FREQUENCY_ATTR_FREQ]);
+	ch->band = band;
+
+	if (tb[NL80211_FREQUENCY_ATTR_DISABLED])
+		ch->flags |= NL80211_WIPHY_CHAN_DISABLED;
+	if (tb[NL80211_FREQUENCY_ATTR_NO_IR])
+		ch->flags |= NL80211_WIPHY_CHAN_NO_IR;
+	if (tb[NL80211_FREQUENCY_ATTR_RADAR])
+		ch->flags |= NL80211_WIPHY_CHAN_RADAR;
+	if (tb[NL80211_FREQUENCY_ATTR_NO_HT40_MINUS])
+		ch->flags |= NL80211_WIPHY_CHAN_NO_HT40_MINUS;
+	if (tb[NL80211_FREQUENCY_ATTR_NO_HT40_PLUS])
+		ch->flags |= NL80211_WIPHY_CHAN_NO_HT40_PLUS;
+	if (tb[NL80211_FREQUENCY_ATTR_NO_80MHZ])
+		ch->flags |= NL80211_WIPHY_CHAN_NO_80MHZ;
+	if (tb[NL80211_FREQUENCY_ATTR_NO_160MHZ])
+		ch->flags |= NL80211_WIPHY_CHAN_NO_160MHZ;
+	if (tb[NL80211_FREQUENCY_ATTR_INDOOR_ONLY])
+		ch->flags |= NL80211_WIPHY_CHAN_INDOOR_ONLY;
+
+	if (tb[NL80211_FREQUENCY_ATTR_DFS_STATE])
+		ch->dfs_state = nla_get_u32(tb[NL80211_FREQUENCY_ATTR_DFS_STATE]);
+	if (tb[NL80211_FREQUENCY_ATTR_MAX_TX_POWER])
+		ch->max_power = nla_get_u32(tb[NL80211_FREQUENCY_ATTR_MAX_TX_POWER]);
+
+	return 0;
+}
+
+static int has_he(struct nlattr *iftype_data)
+{
+	struct nlattr *tb[NL80211_BAND_IFTYPE_ATTR_MAX + 1];
+	struct nlattr *data;
+	int rem;
+
+	nla_for_each_nested(data, iftype_data, rem) {
+		if (nla_parse_nested(tb, NL80211_BAND_IFTYPE_ATTR_MAX, data, NULL))
+			continue;
+		if (tb[NL80211_BAND_IFTYPE_ATTR_HE_CAP_PHY])
+			return 1;
+	}
+	return 0;
+}
+
+/* Bands, and channels of a band, may be spread over several messages */
+static int parse_bands(struct nl80211_wiphy_caps *caps, struct nlattr *bands)
+{
+	struct nlattr *tb[NL80211_BAND_ATTR_MAX + 1];
+	struct nl80211_wiphy_band *b;
+	struct nlattr *band, *freq;
+	int rem_band, rem_freq, err;
+
+	nla_for_each_nested(band, bands, rem_band) {
+		if (nla_type(band) >= NUM_NL80211_BANDS)
+			continue;
+		if (nla_parse_nested(tb, NL80211_BAND_ATTR_MAX, band, NULL))
+			continue;
+
+		b = &caps->bands[nla_type(band)];
+		b->present = 1;
+
+		if (tb[NL80211_BAND_ATTR_HT_CAPA]) {
+			b->has_ht = 1;
+			b->ht_capa = nla_get_u16(tb[NL80211_BAND_ATTR_HT_CAPA]);
+		}
+		if (tb[NL80211_BAND_ATTR_VHT_CAPA]) {
+			b->has_vht = 1;
+			b->vht_capa = nla_get_u32(tb[NL80211_BAND_ATTR_VHT_CAPA]);
+		}
+		if (tb[NL80211_BAND_ATTR_IFTYPE_DATA] && has_he(tb[NL80211_BAND_ATTR_IFTYPE_DATA]))
+			b->has_he = 1;
+
+		if (!tb[NL80211_BAND_ATTR_FREQS])
+			continue;
+
+		nla_for_each_nested(freq, tb[NL80211_BAND_ATTR_FREQS], rem_freq) {
+			err = add_channel(caps, nla_type(band), freq);
+			if (err)
+				return err;
+		}
+	}
+
+	return 0;
+}
+
+static int wiphy_dump_handler(struct nl_msg *msg, void *arg)
+{
+	struct wiphy_dump_args *args = arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nl80211_wiphy_caps *caps;
+	int err;
+
+	if (args->err)
+		return NL_SKIP;
+
+	nl80211_parse(msg, tb);
+	if (!tb[NL80211_ATTR_WIPHY])
+		return NL_SKIP;
+
+	caps = dump_get_wiphy(args, nla_get_u32(tb[NL80211_ATTR_WIPHY]));
+	if (!caps) {
+		args->err = -ENOMEM;
+		return NL_SKIP;
+	}
+
+	if (tb[NL80211_ATTR_WIPHY_NAME])
+		nla_strlcpy(caps->name, tb[NL80211_ATTR_WIPHY_NAME], sizeof(caps->name));
+
+	if (tb[NL80211_ATTR_WIPHY_BANDS]) {
+		err = parse_bands(caps, tb[NL80211_ATTR_WIPHY_BANDS]);
+		if (err)
+			args->err = err;
+	}
+
+	return NL_SKIP;
+}
+
+static void free_wiphys(struct nl80211_wiphy_caps *wiphys, int n_wiphys)
+{
+	int i;
+
+	for (i = 0; i < n_wiphys; i++)
+		free(wiphys[i].channels);
+	free(wiphys);
+}
+
+/*
+ * Dump every wiphy and replace the table on success. The current table is
+ * kept when the dump fails.
+ */
+int nl80211_wiphy_cache_refresh(struct nl80211_wiphy_cache *cache)
+{
+	struct wiphy_dump_args args;
+	struct nl_msg *msg;
+	int err;
+
+	memset(&args, 0, sizeof(args));
+
+	msg = nl80211_msg_alloc(cache->nlstate, NL80211_CMD_GET_WIPHY, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+
+	if (nla_put_flag(msg, NL80211_ATTR_SPLIT_WIPHY_DUMP) < 0) {
+		nlmsg_free(msg);
+		return -ENOBUFS;
+	}
+
+	err = nl80211_send_and_recv(cache->nlstate, msg, wiphy_dump_handler, &args);
+	if (!err)
+		err = args.err;
+	if (err) {
+		free_wiphys(args.wiphys, args.n_wiphys);
+		return err;
+	}
+
+	free_wiphys(cache->wiphys, cache->n_wiphys);
+	cache->wiphys = args.wiphys;
+	cache->n_wiphys = args.n_wiphys;
+	cache->generation++;
+
+	return 0;
+}
+
+static int wiphy_event_handler(struct nl_msg *msg, void *arg)
+{
+	struct nl80211_wiphy_cache *cache = arg;
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+
+	switch (gnlh->cmd) {
+	case NL80211_CMD_REG_CHANGE:
+	case NL80211_CMD_WIPHY_REG_CHANGE:
+	case NL80211_CMD_NEW_WIPHY:
+	case NL80211_CMD_DEL_WIPHY:
+		cache->changed = 1;
+		break;
+	default:
+		break;
+	}
+
+	return NL_SKIP;
+}
+
+static int join_group(struct nl_sock *sock, const char *group)
+{
+	int mcid;
+
+	mcid = nl_get_multicast_id(sock, "nl80211", group);
+	if (mcid < 0)
+		return mcid;
+
+	return nl_socket_add_membership(sock, mcid);
+}
+
+/*
+ * Build the table with requests on nlstate, which must stay valid for the
+ * lifetime of the cache, and subscribe to the changes that invalidate it.
+ */
+int nl80211_wiphy_cache_init(struct nl80211_wiphy_cache *cache, struct nl80211_state *nlstate)
+{
+	int err;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->nlstate = nlstate;
+
+	err = nl80211_init(&cache->evstate);
+	if (err)
+		return err;
+
+	err = join_group(cache->evstate.nl_sock, "regulatory");
+	if (!err)
+		err = join_group(cache->evstate.nl_sock, "config");
+	if (err)
+		goto out_free;
+
+	cache->cb = nl80211_event_cb_alloc(&cache->evstate, wiphy_event_handler, cache);
+	if (!cache->cb) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+
+	/* Subscribed first, a change during the dump triggers another one */
+	err = nl80211_wiphy_cache_refresh(cache);
+	if (err)
+		goto out_free;
+
+	return 0;
+
+ out_free:
+	nl80211_wiphy_cache_free(cache);
+	return err;
+}
+
+void nl80211_wiphy_cache_free(struct nl80211_wiphy_cache *cache)
+{
+	if (cache->cb)
+		nl_cb_put(cache->cb);
+	nl80211_cleanup(&cache->evstate);
+	free_wiphys(cache->wiphys, cache->n_wiphys);
+	memset(cache, 0, sizeof(*cache));
+}
+
+int nl80211_wiphy_cache_get_fd(struct nl80211_wiphy_cache *cache)
+{
+	return nl_socket_get_fd(cache->evstate.nl_sock);
+}
+
+/*
+ * Process pending notifications and refresh the table if any of them
+ * invalidated it. Never blocks on notifications.
+ * Returns 1 if the table was refreshed, 0 if not, or a negative error code.
+ */
+int nl80211_wiphy_cache_dispatch(struct nl80211_wiphy_cache *cache)
+{
+	int err;
+
+	err = nl80211_event_drain(&cache->evstate, cache->cb);
+	if (err < 0)
+		return err;
+
+	/* Notifications were lost, assume the worst */
+	if (err)
+		cache->changed = 1;
+
+	if (!cache->changed)
+		return 0;
+
+	err = nl80211_wiphy_cache_refresh(cache);
+	if (err)
+		return err;
+
+	cache->changed = 0;
+	return 1;
+}
+
+const struct nl80211_wiphy_caps *nl80211_wiphy_cache_get(const struct nl80211_wiphy_cache *cache,
+							 int wiphy)
+{
+	int i;
+
+	for (i = 0; i < cache->n_wiphys; i++)
+		if (cache->wiphys[i].wiphy == wiphy)
+			return &cache->wiphys[i];
+	return NULL;
+}
+
+const struct nl80211_wiphy_channel *nl80211_wiphy_find_channel(const struct nl80211_wiphy_caps *caps,
+							       unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < caps->n_channels; i++)
+		if (caps->channels[i].freq == freq)
+			return &caps->channels[i];
+	return NULL;
+}
+
+/* Whether the radio supports freq and may currently operate on it */
+int nl80211_wiphy_freq_usable(const struct nl80211_wiphy_caps *caps, unsigned int freq)
+{
+	const struct nl80211_wiphy_channel *ch = nl80211_wiphy_find_channel(caps, freq);
+
+	return ch && !(ch->flags & NL80211_WIPHY_CHAN_DISABLED);
+}
+
+static int iface_wiphy_handler(struct nl_msg *msg, void *arg)
+{
+	int *wiphy = arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+
+	nl80211_parse(msg, tb);
+	if (tb[NL80211_ATTR_WIPHY])
+		*wiphy = nla_get_u32(tb[NL80211_ATTR_WIPHY]);
+
+	return NL_SKIP;
+}
+
+/* Index of the wiphy an interface belongs to, or a negative error code */
+int nl80211_wiphy_of_iface(struct nl80211_state *nlstate, int ifindex)
+{
+	struct nl_msg *msg;
+	int wiphy = -ENODEV;
+	int err;
+
+	msg = nl80211_msg_alloc(nlstate, NL80211_CMD_GET_INTERFACE, 0);
+	if (!msg)
+		return -ENOMEM;
+
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+
+	err = nl80211_send_and_recv(nlstate, msg, iface_wiphy_handler, &wiphy);
+	return err ? err : wiphy;
+
+ nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
@@ -0,0 +1,222 @@
+/*   Hash table of stations keyed on their MAC address
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "station_table.h"
+
+#define STATION_TABLE_DEFAULT_SIZE 16
+#define SLOT_EMPTY -1
+
+static unsigned int mac_hash(uint64_t key)
+{
+	/* Fibonacci hashing, the high bits are the well mixed ones */
+	return (unsigned int)((key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+static int slot_find(struct station_table *t, uint64_t key)
+{
+	unsigned int i = mac_hash(key) & t->slot_mask;
+
+	while (t->slots[i] != SLOT_EMPTY) {
+		if (t->entries[t->slots[i]].key == key)
+			return i;
+		i = (i + 1) & t->slot_mask;
+	}
+	return -1;
+}
+
+static void slot_add(struct station_table *t, int idx)
+{
+	unsigned int i = mac_hash(t->entries[idx].key) & t->slot_mask;
+
+	while (t->slots[i] != SLOT_EMPTY)
+		i = (i + 1) & t->slot_mask;
+	t->slots[i] = idx;
+}
+
+/* Backward shift deletion: pull later chain members into the hole */
+static void slot_del(struct station_table *t, unsigned int hole)
+{
+	unsigned int i = hole, home;
+
+	for (;;) {
+		t->slots[hole] = SLOT_EMPTY;
+		for (;;) {
+			i = (i + 1) & t->slot_mask;
+			if (t->slots[i] == SLOT_EMPTY)
+				return;
+			home = mac_hash(t->entries[t->slots[i]].key) & t->slot_mask;
+			/* Movable unless its home lies cyclically in (hole, i] */
+			if (((i - home) & t->slot_mask) >= ((i - hole) & t->slot_mask))
+				break;
+		}
+		t->slots[hole] = t->slots[i];
+		hole = i;
+	}
+}
+
+/* Keep the hash at most half full, slots is a power of two */
+static int slots_resize(struct station_table *t, int size)
+{
+	unsigned int n = 8;
+	int *slots;
+	int idx;
+
+	while (n < (unsigned int)size * 2)
+		n <<= 1;
+
+	/* The old slots stay usable if the allocation fails */
+	slots = malloc(n * sizeof(*slots));
+	if (!slots)
+		return -ENOMEM;
+	memset(slots, 0xff, n * sizeof(*slots));
+
+	free(t->slots);
+	t->slots = slots;
+	t->slot_mask = n - 1;
+
+	for (idx = t->head; idx >= 0; idx = t->entries[idx].next)
+		slot_add(t, idx);
+	return 0;
+}
+
+static int entries_resize(struct station_table *t, int size)
+{
+	struct station_info *entries;
+	int i;
+
+	entries = realloc(t->entries, size * sizeof(*entries));
+	if (!entries)
+		return -ENOMEM;
+	t->entries = entries;
+
+	/* Unused room at the end of entries is harmless, keep the old size */
+	if (slots_resize(t, size))
+		return -ENOMEM;
+
+	/* Chain the new entries into the free list */
+	for (i = size - 1; i >= t->size; i--) {
+		entries[i].next = t->free_list;
+		t->free_list = i;
+	}
+	t->size = size;
+
+	return 0;
+}
+
+int station_table_init(struct station_table *t, int size)
+{
+	memset(t, 0, sizeof(*t));
+	t->free_list = -1;
+	t->head = -1;
+	t->tail = -1;
+
+	if (size <= 0)
+		size = STATION_TABLE_DEFAULT_SIZE;
+
+	if (entries_resize(t, size)) {
+		station_table_free(t);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void station_table_free(struct station_table *t)
+{
+	free(t->entries);
+	free(t->slots);
+	memset(t, 0, sizeof(*t));
+	t->free_list = -1;
+	t->head = -1;
+	t->tail = -1;
+}
+
+struct station_info *station_table_lookup(struct station_table *t, const unsigned char *addr)
+{
+	int slot = slot_find(t, mac_addr_pack(addr));
+
+	return slot < 0 ? NULL : &t->entries[t->slots[slot]];
+}
+
+/*
+ * Get the station of addr, appending a zeroed one if it is unknown.
+ * Returns NULL when memory is exhausted.
+ */
+struct station_info *station_table_insert(struct station_table *t, const unsigned char *addr)
+{
+	struct station_info *sta;
+	int idx;
+
+	sta = station_table_lookup(t, addr);
+	if (sta)
+		return sta;
+
+	if (t->free_list < 0 && entries_resize(t, t->size * 2))
+		return NULL;
+
+	idx = t->free_list;
+	sta = &t->entries[idx];
+	t->free_list = sta->next;
+
+	memset(sta, 0, sizeof(*sta));
+	memcpy(sta->addr, addr, ETH_ALEN);
+	sta->key = mac_addr_pack(addr);
+	sta->prev = t->tail;
+	sta->next = -1;
+	if (t->tail >= 0)
+		t->entries[t->tail].next = idx;
+	else
+		t->head = idx;
+	t->tail = idx;
+
+	slot_add(t, idx);
+	t->num++;
+
+	return sta;
+}
+
+int station_table_remove(struct station_table *t, const unsigned char *addr)
+{
+	struct station_info *sta;
+	int slot, idx;
+
+	slot = slot_find(t, mac_addr_pack(addr));
+	if (slot < 0)
+		return -ENOENT;
+
+	idx = t->slots[slot];
+	sta = &t->entries[idx];
+	slot_del(t, slot);
+
+	if (sta->prev >= 0)
+		t->entries[sta->prev].next = sta->next;
+	else
+		t->head = sta->next;
+	if (sta->next >= 0)
+		t->entries[sta->next].prev = sta->prev;
+	else
+		t->tail = sta->prev;
+
+	sta->next = t->free_list;
+	t->free_list = idx;
+	t->num--;
+
+	return 0;
+}
@@ -24,7 +24,6 @@
 
 #define ADDR_LEN 16
 
-libnm_wrapper_handle_st *st = NULL;
 /**
  * This file provides C APIs to manage network devices and connections based on NetworkManager.
  */
@@ -37,54 +36,100 @@ libnm_wrapper_handle_st *st = NULL;
  */
 /**@{*/
 /**
- * Initialize library handle.
+ * Initialize library handle bound to a main context.
+ * @param context: main context the NMClient of the handle is bound to,
+ *                 NULL to create a private one
  *
  * Returns: pointer to library handle
  *          NULL if unsuccessful
  */
-libnm_wrapper_handle libnm_wrapper_init(void)
+libnm_wrapper_handle libnm_wrapper_init_with_context(GMainContext *context)
 {
-	int i;
+	libnm_wrapper_handle_st *st;
 
-	if(!st) {
-		st = malloc(sizeof(libnm_wrapper_handle_st));
-		st->client = nm_client_new(NULL, NULL);
-	} else {
-		// Process any events that are pending on the main loop that have not
-		// been processed since the last iteration
-		for (i=0; i<10; i++) {
-			if (!g_main_context_iteration(NULL, FALSE))
-				break;
-		}
+	st = g_malloc0(sizeof(libnm_wrapper_handle_st));
+	st->context = context ? g_main_context_ref(context) : g_main_context_new();
+
+	g_main_context_push_thread_default(st->context);
+	st->client = nm_client_new(NULL, NULL);
+	g_main_context_pop_thread_default(st->context);
+
+	if (!st->client)
+	{
+		g_main_context_unref(st->context);
+		g_free(st);
+		return NULL;
 	}
 
+	st->cache = nm_wrapper_cache_new(st->client);
+
 	return (libnm_wrapper_handle) st;
 }
 
 /**
- * Destroy library handle.
+ * Initialize library handle bound to the thread-default main context.
  *
  * Returns: pointer to library handle
+ *          NULL if unsuccessful
+ */
+libnm_wrapper_handle libnm_wrapper_init(void)
+{
+	GMainContext *context = g_main_context_ref_thread_default();
+	libnm_wrapper_handle hd = libnm_wrapper_init_with_context(context);
+
+	g_main_context_unref(context);
+	return hd;
+}
+
+#if NM_CHECK_VERSION(1, 22, 0)
+static void context_busy_watcher_done(gpointer data, GObject *where_the_object_was)
+{
+	*(bool *)data = true;
+}
+#endif
+
+/**
+ * Destroy library handle.
+ * The NMClient and the main context reference are released, so handles may
+ * be created and destroyed repeatedly.
  */
 void libnm_wrapper_destroy(libnm_wrapper_handle hd)
 {
-	int i;
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
 
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	if(!client)
+	if(!st)
 		return;
 
+	nm_wrapper_event_detach_all(st);
+	nm_wrapper_reg_free(st->reg);
+	nm_wrapper_cache_free(st->cache);
+	nm_wrapper_poll_free(st->poll);
+	nm_wrapper_wiphy_free(st->wiphy);
+
+#if NM_CHECK_VERSION(1, 22, 0)
+	{
+		bool done = false;
+
+		// The client keeps sources attached to its context until all pending
+		// D-Bus calls are done, run the context until they are released
+		g_object_weak_ref(nm_client_get_context_busy_watcher(st->client),
+			context_busy_watcher_done, &done);
+		g_object_unref(st->client);
+		while (!done)
+			g_main_context_iteration(st->context, TRUE);
+	}
+#else
 	// Need to process any events that are still on the main loop so cleanup is successful
-	// We should have processed all events we're interested in already but there are many cases
-	// where we have never run the loop at all so internal events have not been processed
 	// Typically only 1 event is still pending, fail-safe just in case
-	for (i=0; i<10; i++) {
-		if (!g_main_context_iteration(NULL, FALSE))
+	for (int i=0; i<10; i++) {
+		if (!g_main_context_iteration(st->context, FALSE))
 			break;
 	}
+	g_object_unref(st->client);
+#endif
 
-	//g_object_unref (client);
-	//free(hd);
+	g_main_context_unref(st->context);
+	g_free(st);
 }
 /**@}*/
 
@@ -99,49 +144,58 @@ void libnm_wrapper_destroy(libnm_wrapper_handle hd)
  */
 typedef struct _libnm_wrapper_cb_st
 {
-	GMainLoop *loop;
-	int *result;
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback;
+	void *user_data;
 	int g_timer_id;
 	NMActiveConnection *active;
 }libnm_wrapper_cb_st;
 
+static libnm_wrapper_cb_st *cb_st_new(LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	libnm_wrapper_cb_st *temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
+
+	temp->callback = callback;
+	temp->user_data = user_data;
+	return temp;
+}
+
+static void cb_st_finish(libnm_wrapper_cb_st *temp, int result)
+{
+	if (temp->callback)
+		temp->callback(result, temp->user_data);
+	g_free(temp);
+}
+
 static void added_cb(GObject *client, GAsyncResult *result, gpointer user_data)
 {
 	GError *error = NULL;
 	NMRemoteConnection *remote;
 	libnm_wrapper_cb_st *temp = (libnm_wrapper_cb_st *)user_data;
-	GMainLoop *loop = temp->loop;
-	int *ret = temp->result;
+	int ret = LIBNM_WRAPPER_ERR_SUCCESS;
 
 	remote = nm_client_add_connection_finish (NM_CLIENT (client), result, &error);
 	if (error) {
-		*ret = LIBNM_WRAPPER_ERR_FAIL;
+		ret = LIBNM_WRAPPER_ERR_FAIL;
 		g_error_free (error);
 	} else {
-		*ret = LIBNM_WRAPPER_ERR_SUCCESS;
 		g_object_unref (remote);
 	}
-	g_free(temp);
-	g_main_loop_quit(loop);
+	cb_st_finish(temp, ret);
 }
 
 /**
  * Create a new connection.
  * @param client: point to NetworkManager client
- * @param connection: connection to be added
- * @param result: location to store result
- *
- * Returns: result = LIBNM_WRAPPER_ERR_SUCCESS successful
+ * @param connection: connection to be added, ownership is taken
+ * @param context: main context the completion is dispatched on
+ * @param temp: completion callback
  */
-static void add_connection(NMClient *client, NMConnection *connection, int *result)
+static void add_connection(NMClient *client, NMConnection *connection,
+					GMainContext *context, libnm_wrapper_cb_st *temp)
 {
-	GMainLoop *loop = g_main_loop_new (NULL, FALSE);
-	libnm_wrapper_cb_st *temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-
-	temp->loop = loop;
-	temp->result = result;
+	context_push(context);
 	nm_client_add_connection_async(client, connection, TRUE, NULL, added_cb, temp);
-	g_main_loop_run (loop);
+	context_pop(context);
 	g_object_unref (connection);
 }
 
@@ -254,7 +308,7 @@ int libnm_wrapper_connection_get_settings(libnm_wrapper_handle hd, const char *i
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if(id)
-		connection = NM_CONNECTION(nm_client_get_connection_by_id(client, id));
+		connection = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, id));
 	else
 		connection = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -277,22 +331,18 @@ int libnm_wrapper_connections_get_settings(libnm_wrapper_handle hd, const char *
 {
 	int i, j;
 	const GPtrArray *connections;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	connections = nm_client_get_connections(client);
+	connections = nm_wrapper_cache_get_connections_by_interface(hd, interface);
+	if (!connections)
+		return 0;
+
 	for (i = j = 0; i < connections->len; i++)
 	{
-		NMConnection *connection = NM_CONNECTION(connections->pdata[i]);
-		NMSettingConnection *s_con = nm_connection_get_setting_connection(connection);
-		const char *ptr = nm_setting_connection_get_interface_name(s_con);
-		if(ptr && !strncmp(ptr, interface, strlen(interface)))
-		{
-			if(j < size)
-				get_settings(connection, &s[j]);
-			++j;
-			if(size && (j >= size))
-				break;
-		}
+		if(j < size)
+			get_settings(NM_CONNECTION(connections->pdata[i]), &s[j]);
+		++j;
+		if(size && (j >= size))
+			break;
 	}
 	return j;
 }
@@ -311,7 +361,7 @@ int libnm_wrapper_active_connection_get_state(libnm_wrapper_handle hd, const cha
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if(active)
-		connection = NM_CONNECTION(nm_client_get_connection_by_id(client, active));
+		connection = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, active));
 	else
 		connection = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -332,7 +382,7 @@ int libnm_wrapper_active_connection_get_state_reason(libnm_wrapper_handle hd, co
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if(active)
-		connection = NM_CONNECTION(nm_client_get_connection_by_id(client, active));
+		connection = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, active));
 	else
 		connection = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -350,9 +400,8 @@ int libnm_wrapper_delete_connection(libnm_wrapper_handle hd, char *id)
 {
 	int ret = LIBNM_WRAPPER_ERR_FAIL;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	if(TRUE == nm_remote_connection_delete(remote, NULL, NULL))
@@ -365,18 +414,50 @@ static void remote_commit_cb(GObject *remote, GAsyncResult *result, gpointer use
 {
 	GError *error = NULL;
 	libnm_wrapper_cb_st *temp = (libnm_wrapper_cb_st *)user_data;
-	GMainLoop *loop = temp->loop;
-	int *ret = temp->result;
+	int ret = LIBNM_WRAPPER_ERR_SUCCESS;
 
 	nm_remote_connection_commit_changes_finish (NM_REMOTE_CONNECTION(remote), result, &error);
 	if (error) {
-		*ret = LIBNM_WRAPPER_ERR_FAIL;
+		ret = LIBNM_WRAPPER_ERR_FAIL;
 		g_error_free (error);
-	} else {
-		*ret = LIBNM_WRAPPER_ERR_SUCCESS;
 	}
-	g_free(temp);
-	g_main_loop_quit(loop);
+	cb_st_finish(temp, ret);
+}
+
+/**
+ * Save the local changes of a remote connection.
+ * @param remote: connection to be committed
+ * @param context: main context the completion is dispatched on
+ * @param temp: completion callback
+ */
+static void commit_changes(NMRemoteConnection *remote, GMainContext *context,
+					libnm_wrapper_cb_st *temp)
+{
+	context_push(context);
+	nm_remote_connection_commit_changes_async(remote, TRUE, NULL, remote_commit_cb, temp);
+	context_pop(context);
+}
+
+/**
+ * Enable/disable auto-start of a connection asynchronously.
+ * @param hd: library handle
+ * @param id: connection id
+ * @param autoconnect: true or false
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the change is committed
+ * @param user_data: passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, callback is
+ *          not invoked otherwise
+ */
+int libnm_wrapper_connection_set_autoconnect_async(libnm_wrapper_handle hd, const char *id, bool autoconnect,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+
+	libnm_wrapper_transaction_stage_autoconnect(tr, autoconnect);
+	return libnm_wrapper_transaction_commit_async(tr, context, callback, user_data);
 }
 
 /**
@@ -389,26 +470,11 @@ static void remote_commit_cb(GObject *remote, GAsyncResult *result, gpointer use
  */
 int libnm_wrapper_connection_set_autoconnect(libnm_wrapper_handle hd, const char *id, bool autoconnect)
 {
-	NMRemoteConnection *remote = NULL;
-	NMSettingConnection *s_con = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	GMainLoop *loop = g_main_loop_new (NULL, FALSE);
-	libnm_wrapper_cb_st *temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-	int result;
-
-	temp->loop = loop;
-	temp->result = &result;
-
-
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER);
-
-	s_con = nm_connection_get_setting_connection(NM_CONNECTION(remote));
-	g_object_set(G_OBJECT(s_con), NM_SETTING_CONNECTION_AUTOCONNECT, autoconnect, NULL);
-	nm_remote_connection_commit_changes_async(remote, TRUE, NULL, remote_commit_cb, temp);
-	g_main_loop_run (loop);
+	libnm_wrapper_sync_st sync;
 
-	return result;
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_connection_set_autoconnect_async(hd, id,
+		autoconnect, NULL, sync_done_cb, &sync));
 }
 
 
@@ -424,9 +490,8 @@ int libnm_wrapper_connection_get_autoconnect(libnm_wrapper_handle hd, const char
 {
 	NMRemoteConnection *remote = NULL;
 	NMSettingConnection *s_con = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_con = nm_connection_get_setting_connection(NM_CONNECTION(remote));
@@ -445,11 +510,6 @@ static void active_connection_state_cb (NMActiveConnection *active,
 
 static void activate_finish(libnm_wrapper_cb_st *temp, int result, bool fromTimer)
 {
-	GMainLoop *loop = temp->loop;
-	int *ret = temp->result;
-
-	*ret = result;
-
 	if(temp->active)
 	{
 		if(fromTimer)
@@ -461,10 +521,7 @@ static void activate_finish(libnm_wrapper_cb_st *temp, int result, bool fromTime
 	if(!fromTimer && temp->g_timer_id > 0)
 		g_source_remove(temp->g_timer_id);
 
-	g_free(temp);
-	temp = NULL;
-
-	g_main_loop_quit(loop);
+	cb_st_finish(temp, result);
 }
 
 static void active_connection_state_cb (NMActiveConnection *active,
@@ -494,17 +551,12 @@ static void activated_cb (GObject *client, GAsyncResult *result, gpointer user_d
 {
 	GError *error = NULL;
 	libnm_wrapper_cb_st *temp = (libnm_wrapper_cb_st *)user_data;
-	GMainLoop *loop = temp->loop;
-	int *ret = temp->result;
 
-	*ret = LIBNM_WRAPPER_ERR_FAIL;
 	temp->active = nm_client_activate_connection_finish(NM_CLIENT (client), result, &error);
 	if (error)
 	{
 		g_error_free (error);
-		g_free(temp);
-		temp = NULL;
-		g_main_loop_quit(loop);
+		cb_st_finish(temp, LIBNM_WRAPPER_ERR_FAIL);
 	}
 	else
 	{
@@ -513,35 +565,34 @@ static void activated_cb (GObject *client, GAsyncResult *result, gpointer user_d
 }
 
 static void activate_connection(NMClient *client, NMConnection *connection,
-					NMDevice *dev, const char *specific_object, int *result)
+					NMDevice *dev, const char *specific_object,
+					GMainContext *context, libnm_wrapper_cb_st *temp)
 {
-	GMainLoop *loop = g_main_loop_new (NULL, FALSE);
-	libnm_wrapper_cb_st *temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-
-	temp->loop = loop;
-	temp->result = result;
-	temp->active = NULL;
-	temp->g_timer_id = 0;
+	context_push(context);
 	nm_client_activate_connection_async(client, connection, dev, specific_object, NULL, activated_cb, temp);
-	g_main_loop_run (loop);
+	context_pop(context);
 }
 
 /**
- * Activate the connection on the interface.
+ * Activate the connection on the interface asynchronously.
  * @param hd: library handle
  * @param interface: on which interface
  * @param id: connection id
  * @param wifi: whether is a wifi connection
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the activation request completes
+ * @param user_data: passed to callback
  *
- * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, callback is
+ *          not invoked otherwise
  */
-int libnm_wrapper_activate_connection(libnm_wrapper_handle hd, const char *interface, char *id, bool wifi)
+int libnm_wrapper_activate_connection_async(libnm_wrapper_handle hd, const char *interface, char *id, bool wifi,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
 {
-	int ret = LIBNM_WRAPPER_ERR_FAIL;
 	NMDevice * dev = NULL;
 	NMRemoteConnection *remote = NULL;
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	remote = nm_client_get_connection_by_id (client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	dev = nm_client_get_device_by_iface(client, interface);
@@ -549,58 +600,94 @@ int libnm_wrapper_activate_connection(libnm_wrapper_handle hd, const char *inter
 		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
 	}
 
-	activate_connection(client, NM_CONNECTION(remote), dev, NULL, &ret);
-	return ret;
+	activate_connection(client, NM_CONNECTION(remote), dev, NULL, handle_context(hd, context),
+		cb_st_new(callback, user_data));
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Activate the connection on the interface.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param id: connection id
+ * @param wifi: whether is a wifi connection
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_activate_connection(libnm_wrapper_handle hd, const char *interface, char *id, bool wifi)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_activate_connection_async(hd, interface, id,
+		wifi, NULL, sync_done_cb, &sync));
 }
 
 static void deactivate_connection_cb(GObject *client, GAsyncResult *result, gpointer user_data)
 {
 	GError *error = NULL;
 	libnm_wrapper_cb_st *temp = (libnm_wrapper_cb_st *)user_data;
-	GMainLoop *loop = temp->loop;
-	int *ret = temp->result;
+	int ret = LIBNM_WRAPPER_ERR_SUCCESS;
 
 	nm_client_deactivate_connection_finish(NM_CLIENT(client), result, &error);
 	if (error) {
-		*ret = LIBNM_WRAPPER_ERR_FAIL;
+		ret = LIBNM_WRAPPER_ERR_FAIL;
 		g_error_free (error);
-	} else {
-		*ret = LIBNM_WRAPPER_ERR_SUCCESS;
 	}
-	g_free(temp);
-	g_main_loop_quit(loop);
+	cb_st_finish(temp, ret);
 }
 
 /**
- * Deactivate the connection on the interface.
+ * Deactivate the connection on the interface asynchronously.
  * @param hd: library handle
  * @param interface: on which interface
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the connection is deactivated,
+ *                  immediately if there is no active connection
+ * @param user_data: passed to callback
  *
- * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, callback is
+ *          not invoked otherwise
  */
-int libnm_wrapper_deactivate_connection(libnm_wrapper_handle hd, const char *interface)
+int libnm_wrapper_deactivate_connection_async(libnm_wrapper_handle hd, const char *interface,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
 {
 	NMDevice * dev = NULL;
 	NMActiveConnection *active = NULL;
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	GMainLoop *loop;
-	libnm_wrapper_cb_st *temp;
-	int result;
 
 	dev = nm_client_get_device_by_iface(client, interface);
 	active = nm_device_get_active_connection(dev);
 	if(!active)
+	{
+		if (callback)
+			callback(LIBNM_WRAPPER_ERR_SUCCESS, user_data);
 		return LIBNM_WRAPPER_ERR_SUCCESS;
+	}
+
+	context = handle_context(hd, context);
+	context_push(context);
+	nm_client_deactivate_connection_async (client, active, NULL, deactivate_connection_cb,
+		cb_st_new(callback, user_data));
+	context_pop(context);
 
-	loop = g_main_loop_new (NULL, FALSE);
-	temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-	temp->loop = loop;
-	temp->result = &result;
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
 
-	nm_client_deactivate_connection_async (client, active, NULL, deactivate_connection_cb, temp);
-	g_main_loop_run (loop);
+/**
+ * Deactivate the connection on the interface.
+ * @param hd: library handle
+ * @param interface: on which interface
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_deactivate_connection(libnm_wrapper_handle hd, const char *interface)
+{
+	libnm_wrapper_sync_st sync;
 
-	return result;
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_deactivate_connection_async(hd, interface,
+		NULL, sync_done_cb, &sync));
 }
 
 /**@}*/
@@ -728,7 +815,7 @@ int libnm_wrapper_connection_get_wireless_settings(libnm_wrapper_handle hd, cons
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if(id)
-		connection = NM_CONNECTION(nm_client_get_connection_by_id(client, id));
+		connection = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, id));
 	else
 		connection = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -1009,7 +1096,7 @@ int libnm_wrapper_connection_get_wireless_security_settings(libnm_wrapper_handle
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if (id)
-		conn = NM_CONNECTION(nm_client_get_connection_by_id(client, id));
+		conn = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, id));
 	else
 		conn = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -1379,185 +1466,816 @@ static int add_wireless_security_settings(NMConnection *connection, NMWrapperWir
 }
 
 /**
- * Create a wifi connection profile.
- * @param hd: library handle
- * @param s: location to store general settings
- * @param ws: location to store wifi settings
- * @param wss: location to store wifi security settings
- * @param wxs: location to store 8021x settings
+ * Build a new wifi connection from user settings.
+ * @param client: point to NetworkManager client
+ * @param s: general settings
+ * @param ws: wifi settings
+ * @param wss: wifi security settings
+ * @param wxs: 8021x settings
+ * @param connection: location to store the new connection
  *
  * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
  */
-int libnm_wrapper_connection_add_wireless_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs)
+static int new_wireless_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWirelessSettings* ws,
+	NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs, NMConnection **connection)
 {
-	int ret = LIBNM_WRAPPER_ERR_FAIL;
 	GError *err = NULL;
-	NMConnection *connection = NULL;
+	NMConnection *conn = NULL;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id (client, s->id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, s->id);
 	if (remote)
 		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
 
-	connection = nm_simple_connection_new();
+	conn = nm_simple_connection_new();
 
-	add_settings(connection, s);
+	add_settings(conn, s);
 
-	add_wireless_settings(connection, ws);
+	add_wireless_settings(conn, ws);
 
 	if (wss->key_mgmt[0])
 	{
-		if(LIBNM_WRAPPER_ERR_SUCCESS != add_wireless_security_settings(connection, wss, wxs))
+		if(LIBNM_WRAPPER_ERR_SUCCESS != add_wireless_security_settings(conn, wss, wxs))
+		{
+			g_object_unref(conn);
 			return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+		}
 	}
 
-	nm_connection_normalize(connection, NULL, NULL, &err);
+	nm_connection_normalize(conn, NULL, NULL, &err);
 	if (err)
 	{
 		g_error_free (err);
+		g_object_unref(conn);
 		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
 	}
 
-	add_connection(client, connection, &ret);
-	return ret;
+	*connection = conn;
+	return LIBNM_WRAPPER_ERR_SUCCESS;
 }
 
 /**
- * Update a wifi connection profile.
+ * Create a wifi connection profile asynchronously.
  * @param hd: library handle
- * @param id: id of the connection to be updated
  * @param s: location to store general settings
  * @param ws: location to store wifi settings
  * @param wss: location to store wifi security settings
  * @param wxs: location to store 8021x settings
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once NetworkManager has added the profile
+ * @param user_data: passed to callback
  *
- * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, callback is
+ *          not invoked otherwise
  */
-int libnm_wrapper_connection_update_wireless_connection(libnm_wrapper_handle hd, const char *id, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs)
+int libnm_wrapper_connection_add_wireless_connection_async(libnm_wrapper_handle hd, NMWrapperSettings *s,
+	NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
 {
-	GError *err = NULL;
+	int ret;
 	NMConnection *connection = NULL;
-	NMRemoteConnection *remote = NULL;
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	GMainLoop *loop;
-	libnm_wrapper_cb_st *temp;
-	int result;
-
-	remote = nm_client_get_connection_by_id (client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-	connection = NM_CONNECTION(remote);
-
-	update_settings(connection, s);
 
-	add_wireless_settings(connection, ws);
-
-	if (wss->key_mgmt[0])
-	{
-		if(LIBNM_WRAPPER_ERR_SUCCESS != add_wireless_security_settings(connection, wss, wxs))
-			return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
-	}
-
-	nm_connection_normalize(NM_CONNECTION(remote), NULL, NULL, &err);
-	if (err)
-	{
-		g_error_free (err);
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-	}
-
-	loop = g_main_loop_new (NULL, FALSE);
-	temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-	temp->loop = loop;
-	temp->result = &result;
-
-	nm_remote_connection_commit_changes_async(remote, TRUE, NULL, remote_commit_cb, temp);
-	g_main_loop_run(loop);
+	ret = new_wireless_connection(hd, s, ws, wss, wxs, &connection);
+	if (ret != LIBNM_WRAPPER_ERR_SUCCESS)
+		return ret;
 
-	return result;
+	add_connection(client, connection, handle_context(hd, context), cb_st_new(callback, user_data));
+	return LIBNM_WRAPPER_ERR_SUCCESS;
 }
 
-/**@}*/
-
-/**
- * @name Wired connection management API
- */
-/**@{*/
 /**
- * Create a wired connection profile.
+ * Create a wifi connection profile.
  * @param hd: library handle
  * @param s: location to store general settings
- * @param ws: location to store wired settings
+ * @param ws: location to store wifi settings
+ * @param wss: location to store wifi security settings
+ * @param wxs: location to store 8021x settings
  *
  * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
  */
-static void add_wired_settings(NMConnection *connection, NMWrapperWiredSettings *ws)
+int libnm_wrapper_connection_add_wireless_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs)
 {
-	NMSettingWired *s_wired = nm_connection_get_setting_wired(connection);
-	if(s_wired)
-		nm_connection_remove_setting (connection, G_OBJECT_TYPE (s_wired));
-
-	s_wired = (NMSettingWired *) nm_setting_wireless_new();
-	nm_connection_add_setting (connection, NM_SETTING(s_wired));
-
-	g_object_set (s_wired,
-		NM_SETTING_WIRED_SPEED, ws->speed,
-		NM_SETTING_WIRED_AUTO_NEGOTIATE, ws->auto_negotiate,
-		NM_SETTING_WIRED_WAKE_ON_LAN, ws->wol, NULL);
-
-	if (ws->duplex[0])
-		g_object_set (s_wired, NM_SETTING_WIRED_DUPLEX, ws->duplex, NULL);
+	libnm_wrapper_sync_st sync;
 
-	if (ws->wol_password[0])
-		g_object_set (s_wired, NM_SETTING_WIRED_WAKE_ON_LAN_PASSWORD, ws->wol_password, NULL);
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_connection_add_wireless_connection_async(hd, s,
+		ws, wss, wxs, NULL, sync_done_cb, &sync));
 }
 
-int libnm_wrapper_connection_add_wired_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWiredSettings *ws)
+/**
+ * Update a wifi connection profile asynchronously.
+ * @param hd: library handle
+ * @param id: id of the connection to be updated
+ * @param s: location to store general settings
+ * @param ws: location to store wifi settings
+ * @param wss: location to store wifi security settings
+ * @param wxs: location to store 8021x settings
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the change is committed
+ * @param user_data: passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, callback is
+ *          not invoked otherwise
+ */
+int libnm_wrapper_connection_update_wireless_connection_async(libnm_wrapper_handle hd, const char *id,
+	NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss,
+	NMWrapperWireless8021xSettings *wxs, GMainContext *context,
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
 {
-	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	GError *err = NULL;
-	NMConnection *connection = NULL;
-	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	remote = nm_client_get_connection_by_id (client, s->id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	connection = nm_simple_connection_new();
-	add_settings(connection, s);
-	add_wired_settings(connection, ws);
-
-	nm_connection_normalize(connection, NULL, NULL, &err);
-	if(err)
-	{
-		g_error_free (err);
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-	}
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	add_connection(client, connection, &ret);
-	return ret;
+	libnm_wrapper_transaction_stage_settings(tr, s);
+	libnm_wrapper_transaction_stage_wireless_settings(tr, ws);
+	libnm_wrapper_transaction_stage_wireless_security_settings(tr, wss, wxs);
+	return libnm_wrapper_transaction_commit_async(tr, context, callback, user_data);
 }
 
 /**
- * Update a wired connection profile.
+ * Update a wifi connection profile.
  * @param hd: library handle
- * @param id: connection id
+ * @param id: id of the connection to be updated
  * @param s: location to store general settings
- * @param ws: location to store wired settings
+ * @param ws: location to store wifi settings
+ * @param wss: location to store wifi security settings
+ * @param wxs: location to store 8021x settings
  *
  * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
  */
-int libnm_wrapper_connection_update_wired_connection(libnm_wrapper_handle hd, const char *id, NMWrapperSettings *s, NMWrapperWiredSettings* ws)
+int libnm_wrapper_connection_update_wireless_connection(libnm_wrapper_handle hd, const char *id, NMWrapperSettings *s, NMWrapperWirelessSettings* ws, NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs)
 {
-	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	GError *err = NULL;
-	NMConnection *connection = NULL;
-	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	libnm_wrapper_sync_st sync;
 
-	remote = nm_client_get_connection_by_id (client, s->id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_connection_update_wireless_connection_async(hd, id,
+		s, ws, wss, wxs, NULL, sync_done_cb, &sync));
+}
 
-	connection = nm_simple_connection_new();
+/**
+ * Bulk provisioning keeps up to max_in_flight requests outstanding and
+ * refills the pipeline from the completion callbacks.
+ */
+typedef enum _libnm_wrapper_bulk_phase
+{
+	BULK_PHASE_ADD,
+	BULK_PHASE_SAVE,
+} libnm_wrapper_bulk_phase;
+
+typedef struct _libnm_wrapper_bulk_st
+{
+	libnm_wrapper_handle hd;
+	NMClient *client;
+	GMainContext *context;
+	GMainLoop *loop;
+	NMWrapperWirelessProfile *profiles;
+	NMRemoteConnection **remotes;
+	// Ids of the profiles added by this batch, the cache only knows about completed adds
+	GHashTable *ids;
+	libnm_wrapper_bulk_phase phase;
+	bool in_memory;
+	int num;
+	int next;
+	int in_flight;
+	int max_in_flight;
+}libnm_wrapper_bulk_st;
+
+typedef struct _libnm_wrapper_bulk_op_st
+{
+	libnm_wrapper_bulk_st *bulk;
+	int index;
+}libnm_wrapper_bulk_op_st;
+
+static void bulk_pump(libnm_wrapper_bulk_st *bulk);
+
+static void bulk_op_finish(libnm_wrapper_bulk_op_st *op, int result)
+{
+	libnm_wrapper_bulk_st *bulk = op->bulk;
+
+	bulk->profiles[op->index].result = result;
+	bulk->in_flight--;
+	g_free(op);
+
+	bulk_pump(bulk);
+	if (!bulk->in_flight)
+		g_main_loop_quit(bulk->loop);
+}
+
+static void bulk_added_cb(GObject *client, GAsyncResult *result, gpointer user_data)
+{
+	GError *error = NULL;
+	libnm_wrapper_bulk_op_st *op = (libnm_wrapper_bulk_op_st *)user_data;
+	NMRemoteConnection *remote;
+
+	remote = nm_client_add_connection_finish(NM_CLIENT(client), result, &error);
+	if (error) {
+		g_error_free(error);
+		bulk_op_finish(op, LIBNM_WRAPPER_ERR_FAIL);
+		return;
+	}
+
+	// Keep the reference for the save phase
+	op->bulk->remotes[op->index] = remote;
+	bulk_op_finish(op, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+static void bulk_deleted_cb(GObject *remote, GAsyncResult *result, gpointer user_data)
+{
+	GError *error = NULL;
+	libnm_wrapper_bulk_op_st *op = (libnm_wrapper_bulk_op_st *)user_data;
+
+	nm_remote_connection_delete_finish(NM_REMOTE_CONNECTION(remote), result, &error);
+	if (error)
+		g_error_free(error);
+	bulk_op_finish(op, LIBNM_WRAPPER_ERR_FAIL);
+}
+
+static void bulk_saved_cb(GObject *remote, GAsyncResult *result, gpointer user_data)
+{
+	GError *error = NULL;
+	libnm_wrapper_bulk_op_st *op = (libnm_wrapper_bulk_op_st *)user_data;
+
+	nm_remote_connection_save_finish(NM_REMOTE_CONNECTION(remote), result, &error);
+	if (error) {
+		g_error_free(error);
+		// Don't leave a profile reported as failed behind as an unsaved in-memory one
+		context_push(op->bulk->context);
+		nm_remote_connection_delete_async(NM_REMOTE_CONNECTION(remote), NULL, bulk_deleted_cb, op);
+		context_pop(op->bulk->context);
+		return;
+	}
+	bulk_op_finish(op, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+/**
+ * Start the request of the current phase for one profile.
+ *
+ * Returns: true if a request is in flight, false if the profile is done
+ */
+static bool bulk_start(libnm_wrapper_bulk_st *bulk, int index)
+{
+	NMWrapperWirelessProfile *p = &bulk->profiles[index];
+	libnm_wrapper_bulk_op_st *op;
+	NMConnection *connection = NULL;
+
+	if (bulk->phase == BULK_PHASE_ADD)
+	{
+		if (p->s && g_hash_table_contains(bulk->ids, p->s->id))
+		{
+			p->result = LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+			return false;
+		}
+		p->result = new_wireless_connection(bulk->hd, p->s, p->ws, p->wss, p->wxs, &connection);
+		if (p->result != LIBNM_WRAPPER_ERR_SUCCESS)
+			return false;
+		g_hash_table_add(bulk->ids, p->s->id);
+	}
+	else if (p->result != LIBNM_WRAPPER_ERR_SUCCESS || !bulk->remotes[index])
+		return false;
+
+	op = g_malloc0(sizeof(libnm_wrapper_bulk_op_st));
+	op->bulk = bulk;
+	op->index = index;
+
+	context_push(bulk->context);
+	if (bulk->phase == BULK_PHASE_ADD)
+	{
+		nm_client_add_connection_async(bulk->client, connection, !bulk->in_memory, NULL, bulk_added_cb, op);
+		g_object_unref(connection);
+	}
+	else
+	{
+		nm_remote_connection_save_async(bulk->remotes[index], NULL, bulk_saved_cb, op);
+	}
+	context_pop(bulk->context);
+
+	return true;
+}
+
+static void bulk_pump(libnm_wrapper_bulk_st *bulk)
+{
+	while (bulk->in_flight < bulk->max_in_flight && bulk->next < bulk->num)
+	{
+		if (bulk_start(bulk, bulk->next++))
+			bulk->in_flight++;
+	}
+}
+
+static void bulk_run(libnm_wrapper_bulk_st *bulk, libnm_wrapper_bulk_phase phase)
+{
+	bulk->phase = phase;
+	bulk->next = 0;
+	bulk_pump(bulk);
+	if (bulk->in_flight)
+		g_main_loop_run(bulk->loop);
+}
+
+/**
+ * Create many wifi connection profiles with a bounded number of requests in flight.
+ * @param hd: library handle
+ * @param profiles: profiles to add, the result of each one is stored in its result field
+ * @param num: number of profiles
+ * @param max_in_flight: maximum number of outstanding requests,
+ *                       LIBNM_WRAPPER_BULK_DEFAULT_IN_FLIGHT if not positive
+ * @param flags: LIBNM_WRAPPER_BULK_IN_MEMORY to add all profiles in-memory
+ *               first and persist them afterwards, a profile that fails to
+ *               be persisted is deleted again
+ *
+ * A profile whose id is already used, by an existing connection or by an
+ * earlier profile of the same batch, fails with LIBNM_WRAPPER_ERR_INVALID_PARAMETER.
+ *
+ * Returns: number of profiles successfully added
+ */
+int libnm_wrapper_connection_add_wireless_connections(libnm_wrapper_handle hd,
+	NMWrapperWirelessProfile *profiles, int num, int max_in_flight, unsigned int flags)
+{
+	int i, added = 0;
+	libnm_wrapper_bulk_st bulk;
+
+	if (num <= 0)
+		return 0;
+
+	memset(&bulk, 0, sizeof(bulk));
+	bulk.hd = hd;
+	bulk.client = ((libnm_wrapper_handle_st *)hd)->client;
+	bulk.context = handle_context(hd, NULL);
+	bulk.loop = g_main_loop_new(bulk.context, FALSE);
+	bulk.profiles = profiles;
+	bulk.remotes = g_malloc0(num * sizeof(NMRemoteConnection *));
+	bulk.ids = g_hash_table_new(g_str_hash, g_str_equal);
+	bulk.in_memory = (flags & LIBNM_WRAPPER_BULK_IN_MEMORY) != 0;
+	bulk.num = num;
+	bulk.max_in_flight = max_in_flight > 0 ? max_in_flight : LIBNM_WRAPPER_BULK_DEFAULT_IN_FLIGHT;
+
+	for (i = 0; i < num; i++)
+		profiles[i].result = LIBNM_WRAPPER_ERR_FAIL;
+
+	bulk_run(&bulk, BULK_PHASE_ADD);
+	if (bulk.in_memory)
+		bulk_run(&bulk, BULK_PHASE_SAVE);
+
+	for (i = 0; i < num; i++)
+	{
+		if (profiles[i].result == LIBNM_WRAPPER_ERR_SUCCESS)
+			added++;
+		if (bulk.remotes[i])
+			g_object_unref(bulk.remotes[i]);
+	}
+
+	g_hash_table_unref(bulk.ids);
+	g_free(bulk.remotes);
+	g_main_loop_unref(bulk.loop);
+	return added;
+}
+
+/**@}*/
+
+/**
+ * @name Connection transaction API
+ * Stage changes to several settings of a connection and commit them with a
+ * single D-Bus round trip. Changes are staged on a private copy, so the
+ * connection is left untouched if any of them fails.
+ */
+/**@{*/
+typedef struct _libnm_wrapper_transaction_st
+{
+	libnm_wrapper_handle hd;
+	NMRemoteConnection *remote;
+	NMConnection *connection;
+	// First staging error, reported by commit
+	int result;
+}libnm_wrapper_transaction_st;
+
+static int transaction_stage_result(libnm_wrapper_transaction_st *tr, int ret)
+{
+	if (tr->result == LIBNM_WRAPPER_ERR_SUCCESS)
+		tr->result = ret;
+	return ret;
+}
+
+static void transaction_free(libnm_wrapper_transaction_st *tr)
+{
+	g_object_unref(tr->connection);
+	g_object_unref(tr->remote);
+	g_free(tr);
+}
+
+static NMSettingIPConfig *get_setting_ip_config(NMConnection *connection, int family)
+{
+	if (family == AF_INET6)
+		return nm_connection_get_setting_ip6_config(connection);
+	return nm_connection_get_setting_ip4_config(connection);
+}
+
+static int stage_ip_method(NMConnection *connection, int family, const char *value)
+{
+	NMSettingIPConfig *s_ip = get_setting_ip_config(connection, family);
+
+	//"manual" will be set when ip address is set;
+	if(!strncmp(value, NM_SETTING_IP4_CONFIG_METHOD_MANUAL, strlen(NM_SETTING_IP4_CONFIG_METHOD_MANUAL)))
+		return LIBNM_WRAPPER_ERR_SUCCESS;
+
+	if(!s_ip)
+		return LIBNM_WRAPPER_ERR_FAIL;
+
+	g_object_set (G_OBJECT(NM_SETTING(s_ip)), NM_SETTING_IP_CONFIG_METHOD, value, NULL);
+	nm_setting_ip_config_clear_addresses(s_ip);
+	nm_setting_ip_config_clear_dns(s_ip);
+	nm_setting_ip_config_clear_routes(s_ip);
+	g_object_set (G_OBJECT(NM_SETTING(s_ip)), NM_SETTING_IP_CONFIG_GATEWAY, NULL, NULL);
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+static int stage_ip_address(NMConnection *connection, int family, const int index,
+	const char *address, const char *netmask, const char *gateway)
+{
+	NMIPAddress *addr;
+	NMSettingIPConfig *s_ip = get_setting_ip_config(connection, family);
+
+	if(!s_ip)
+		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+
+	//Force to "manual" method to set ip address
+	g_object_set (G_OBJECT(NM_SETTING(s_ip)), NM_SETTING_IP_CONFIG_METHOD, "manual", NULL);
+
+	if (nm_setting_ip_config_get_num_addresses(s_ip) == 0)
+	{
+		if (family == AF_INET6)
+			addr = nm_ip_address_new(AF_INET6, "::", 128, NULL);
+		else
+			addr = nm_ip_address_new(AF_INET, "192.168.1.1", 24, NULL);
+		nm_setting_ip_config_add_address(s_ip, addr);
+		nm_ip_address_unref(addr);
+	}
+
+	if (index >= nm_setting_ip_config_get_num_addresses(s_ip))
+		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+
+	addr = nm_setting_ip_config_get_address(s_ip, index);
+
+	if (address && address[0])
+		nm_ip_address_set_address(addr, address);
+
+	if (netmask && netmask[0])
+	{
+		int prefix = atoi(netmask);
+		if(prefix > 0 && (family == AF_INET6 || prefix < 32))
+			nm_ip_address_set_prefix(addr, prefix);
+	}
+
+	if (gateway && gateway[0])
+		g_object_set (G_OBJECT(NM_SETTING(s_ip)), NM_SETTING_IP_CONFIG_GATEWAY, gateway, NULL);
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+static int stage_ip_dns(NMConnection *connection, int family, const char *address)
+{
+	int ret = LIBNM_WRAPPER_ERR_SUCCESS;
+	NMSettingIPConfig *s_ip = get_setting_ip_config(connection, family);
+	GStrv tokens;
+
+	if(!s_ip)
+		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+
+	nm_setting_ip_config_clear_dns(s_ip);
+	if(!address)
+		return ret;
+
+	tokens = g_strsplit(address, " ", -1);
+	for (int i = 0; tokens[i] && ret == LIBNM_WRAPPER_ERR_SUCCESS; i++)
+	{
+		if (!tokens[i][0])
+			continue;
+		if(nm_utils_ipaddr_valid(family, tokens[i]) == FALSE)
+			ret = LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+		else if(FALSE == nm_setting_ip_config_add_dns(s_ip, tokens[i]))
+			ret = LIBNM_WRAPPER_ERR_FAIL;
+	}
+	g_strfreev(tokens);
+
+	return ret;
+}
+
+/**
+ * Begin a transaction on a connection.
+ * @param hd: library handle
+ * @param id: connection id
+ *
+ * Returns: transaction handle, NULL if the connection does not exist
+ */
+libnm_wrapper_transaction libnm_wrapper_transaction_begin(libnm_wrapper_handle hd, const char *id)
+{
+	NMRemoteConnection *remote = NULL;
+	libnm_wrapper_transaction_st *tr;
+
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
+	nm_wrapper_assert(remote, NULL)
+
+	tr = g_malloc0(sizeof(libnm_wrapper_transaction_st));
+	tr->hd = hd;
+	tr->remote = g_object_ref(remote);
+	tr->connection = nm_simple_connection_new_clone(NM_CONNECTION(remote));
+	tr->result = LIBNM_WRAPPER_ERR_SUCCESS;
+	return (libnm_wrapper_transaction) tr;
+}
+
+/**
+ * Stage general settings.
+ * @param tr: transaction handle
+ * @param s: general settings
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_settings(libnm_wrapper_transaction tr, NMWrapperSettings *s)
+{
+	update_settings(((libnm_wrapper_transaction_st *)tr)->connection, s);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Stage auto-start of the connection.
+ * @param tr: transaction handle
+ * @param autoconnect: true or false
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_autoconnect(libnm_wrapper_transaction tr, bool autoconnect)
+{
+	NMConnection *connection = ((libnm_wrapper_transaction_st *)tr)->connection;
+	NMSettingConnection *s_con = nm_connection_get_setting_connection(connection);
+
+	g_object_set(G_OBJECT(s_con), NM_SETTING_CONNECTION_AUTOCONNECT, autoconnect, NULL);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Stage wifi settings.
+ * @param tr: transaction handle
+ * @param ws: wifi settings
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_wireless_settings(libnm_wrapper_transaction tr, NMWrapperWirelessSettings *ws)
+{
+	add_wireless_settings(((libnm_wrapper_transaction_st *)tr)->connection, ws);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Stage wifi security and 802.1x settings. Nothing is staged if no key
+ * management is set.
+ * @param tr: transaction handle
+ * @param wss: wifi security settings
+ * @param wxs: 8021x settings
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_wireless_security_settings(libnm_wrapper_transaction tr,
+	NMWrapperWirelessSecuritySettings *wss, NMWrapperWireless8021xSettings *wxs)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+
+	if (!wss->key_mgmt[0])
+		return LIBNM_WRAPPER_ERR_SUCCESS;
+
+	if(LIBNM_WRAPPER_ERR_SUCCESS != add_wireless_security_settings(st->connection, wss, wxs))
+		return transaction_stage_result(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER);
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Stage IPv4 method. "manual" is implied by staging an address.
+ * @param tr: transaction handle
+ * @param value: method
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv4_method(libnm_wrapper_transaction tr, const char *value)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_method(st->connection, AF_INET, value));
+}
+
+/**
+ * Stage IPv4 address, switches the method to "manual".
+ * @param tr: transaction handle
+ * @param index: index of the address
+ * @param address: address, unchanged if NULL or empty
+ * @param netmask: prefix length, unchanged if NULL or empty
+ * @param gateway: gateway, unchanged if NULL or empty
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv4_address(libnm_wrapper_transaction tr, const int index,
+	const char *address, const char *netmask, const char *gateway)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_address(st->connection, AF_INET, index,
+		address, netmask, gateway));
+}
+
+/**
+ * Stage IPv4 DNS servers.
+ * @param tr: transaction handle
+ * @param address: space separated list of servers, NULL to clear
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv4_dns(libnm_wrapper_transaction tr, const char *address)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_dns(st->connection, AF_INET, address));
+}
+
+/**
+ * Stage IPv6 method. "manual" is implied by staging an address.
+ * @param tr: transaction handle
+ * @param value: method
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv6_method(libnm_wrapper_transaction tr, const char *value)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_method(st->connection, AF_INET6, value));
+}
+
+/**
+ * Stage IPv6 address, switches the method to "manual".
+ * @param tr: transaction handle
+ * @param index: index of the address
+ * @param address: address, unchanged if NULL or empty
+ * @param netmask: prefix length, unchanged if NULL or empty
+ * @param gateway: gateway, unchanged if NULL or empty
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv6_address(libnm_wrapper_transaction tr, const int index,
+	const char *address, const char *netmask, const char *gateway)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_address(st->connection, AF_INET6, index,
+		address, netmask, gateway));
+}
+
+/**
+ * Stage IPv6 DNS servers.
+ * @param tr: transaction handle
+ * @param address: space separated list of servers, NULL to clear
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_transaction_stage_ipv6_dns(libnm_wrapper_transaction tr, const char *address)
+{
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	return transaction_stage_result(st, stage_ip_dns(st->connection, AF_INET6, address));
+}
+
+/**
+ * Commit all staged changes asynchronously and release the transaction.
+ * @param tr: transaction handle
+ * @param context: main context to run the operation on, NULL for the handle's one
+ * @param callback: called with the result once the changes are committed
+ * @param user_data: passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started, otherwise the
+ *          first staging error, and callback is not invoked
+ */
+int libnm_wrapper_transaction_commit_async(libnm_wrapper_transaction tr, GMainContext *context,
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	GError *err = NULL;
+	libnm_wrapper_transaction_st *st = (libnm_wrapper_transaction_st *)tr;
+	int ret = st->result;
+
+	if (ret == LIBNM_WRAPPER_ERR_SUCCESS)
+	{
+		nm_connection_normalize(st->connection, NULL, NULL, &err);
+		if (err)
+		{
+			g_error_free (err);
+			ret = LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+		}
+	}
+
+	if (ret == LIBNM_WRAPPER_ERR_SUCCESS)
+	{
+		nm_connection_replace_settings_from_connection(NM_CONNECTION(st->remote), st->connection);
+		commit_changes(st->remote, handle_context(st->hd, context), cb_st_new(callback, user_data));
+	}
+
+	transaction_free(st);
+	return ret;
+}
+
+/**
+ * Commit all staged changes and release the transaction.
+ * @param tr: transaction handle
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful, otherwise the first
+ *          staging error or the commit error
+ */
+int libnm_wrapper_transaction_commit(libnm_wrapper_transaction tr)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(((libnm_wrapper_transaction_st *)tr)->hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_transaction_commit_async(tr, NULL, sync_done_cb, &sync));
+}
+
+/**
+ * Drop all staged changes and release the transaction.
+ * @param tr: transaction handle
+ */
+void libnm_wrapper_transaction_abort(libnm_wrapper_transaction tr)
+{
+	transaction_free((libnm_wrapper_transaction_st *)tr);
+}
+/**@}*/
+
+/**
+ * @name Wired connection management API
+ */
+/**@{*/
+/**
+ * Create a wired connection profile.
+ * @param hd: library handle
+ * @param s: location to store general settings
+ * @param ws: location to store wired settings
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+static void add_wired_settings(NMConnection *connection, NMWrapperWiredSettings *ws)
+{
+	NMSettingWired *s_wired = nm_connection_get_setting_wired(connection);
+	if(s_wired)
+		nm_connection_remove_setting (connection, G_OBJECT_TYPE (s_wired));
+
+	s_wired = (NMSettingWired *) nm_setting_wireless_new();
+	nm_connection_add_setting (connection, NM_SETTING(s_wired));
+
+	g_object_set (s_wired,
+		NM_SETTING_WIRED_SPEED, ws->speed,
+		NM_SETTING_WIRED_AUTO_NEGOTIATE, ws->auto_negotiate,
+		NM_SETTING_WIRED_WAKE_ON_LAN, ws->wol, NULL);
+
+	if (ws->duplex[0])
+		g_object_set (s_wired, NM_SETTING_WIRED_DUPLEX, ws->duplex, NULL);
+
+	if (ws->wol_password[0])
+		g_object_set (s_wired, NM_SETTING_WIRED_WAKE_ON_LAN_PASSWORD, ws->wol_password, NULL);
+}
+
+int libnm_wrapper_connection_add_wired_connection(libnm_wrapper_handle hd, NMWrapperSettings *s, NMWrapperWiredSettings *ws)
+{
+	libnm_wrapper_sync_st sync;
+	GError *err = NULL;
+	NMConnection *connection = NULL;
+	NMRemoteConnection *remote = NULL;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	remote = nm_wrapper_cache_get_connection_by_id(hd, s->id);
+	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+
+	connection = nm_simple_connection_new();
+	add_settings(connection, s);
+	add_wired_settings(connection, ws);
+
+	nm_connection_normalize(connection, NULL, NULL, &err);
+	if(err)
+	{
+		g_error_free (err);
+		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+	}
+
+	sync_init(&sync, handle_context(hd, NULL));
+	add_connection(client, connection, handle_context(hd, NULL), cb_st_new(sync_done_cb, &sync));
+	return sync_wait(&sync, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+/**
+ * Update a wired connection profile.
+ * @param hd: library handle
+ * @param id: connection id
+ * @param s: location to store general settings
+ * @param ws: location to store wired settings
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_connection_update_wired_connection(libnm_wrapper_handle hd, const char *id, NMWrapperSettings *s, NMWrapperWiredSettings* ws)
+{
+	int ret = LIBNM_WRAPPER_ERR_FAIL;
+	GError *err = NULL;
+	NMConnection *connection = NULL;
+	NMRemoteConnection *remote = NULL;
+
+	remote = nm_wrapper_cache_get_connection_by_id(hd, s->id);
+	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+
+	connection = nm_simple_connection_new();
 
 	update_settings(connection, s);
 	add_wired_settings(connection, ws);
@@ -1610,7 +2328,7 @@ int libnm_wrapper_connection_get_wired_settings(libnm_wrapper_handle hd, const c
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
 	if(id)
-		connection = NM_CONNECTION(nm_client_get_connection_by_id(client, id));
+		connection = NM_CONNECTION(nm_wrapper_cache_get_connection_by_id(hd, id));
 	else
 		connection = NM_CONNECTION(get_active_connection(client, interface));
 
@@ -1673,6 +2391,61 @@ int libnm_wrapper_access_point_get_scanlist(libnm_wrapper_handle hd, const char
 	return i;
 }
 
+/**
+ * Visit the AP list without copying it.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param visitor: called for each AP, NULL to only count them
+ * @param user_data: user data passed to visitor
+ * @param total: location to store the number of APs, may be NULL
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_access_point_foreach(libnm_wrapper_handle hd, const char *interface,
+	LIBNM_WRAPPER_ACCESS_POINT_VISITOR visitor, void *user_data, int *total)
+{
+	GBytes *ssid;
+	const char *bssid;
+	NMDevice *dev = NULL;
+	const GPtrArray *aps = NULL;
+	NMWrapperAccessPointView view;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	dev = nm_client_get_device_by_iface(client, interface);
+	if (!dev || !NM_IS_DEVICE_WIFI(dev))
+		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+	aps = nm_device_wifi_get_access_points(NM_DEVICE_WIFI(dev));
+	if (total)
+		*total = aps ? aps->len : 0;
+
+	for (int i = 0; visitor && aps && i < aps->len; i++)
+	{
+		NMAccessPoint *ap = g_ptr_array_index(aps, i);
+
+		ssid = nm_access_point_get_ssid(ap);
+		view.ssid = ssid ? g_bytes_get_data(ssid, &view.ssid_len) : NULL;
+		if (!view.ssid)
+			view.ssid_len = 0;
+
+		bssid = nm_access_point_get_bssid(ap);
+		if (!bssid || !bssid_parse(bssid, view.bssid))
+			memset(view.bssid, 0, sizeof(view.bssid));
+
+		view.mode = nm_access_point_get_mode(ap);
+		view.frequency = nm_access_point_get_frequency(ap);
+		view.strength = nm_access_point_get_strength(ap);
+		view.flags = nm_access_point_get_flags(ap);
+		view.wpa_flags = nm_access_point_get_wpa_flags(ap);
+		view.rsn_flags = nm_access_point_get_rsn_flags(ap);
+
+		if (visitor(&view, user_data))
+			break;
+	}
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
 /**
  * Get active AP settings.
  * @param hd: library handle
@@ -1713,18 +2486,9 @@ int libnm_wrapper_access_point_get_active_settings(libnm_wrapper_handle hd, cons
 					(dst) = (dflt); \
 			} G_STMT_END
 
-int libnm_wrapper_ipv4_get_route_information(libnm_wrapper_handle hd, const char *interface, const char *id, NMWrapperIPRoute *route, int size)
+static int get_routes(NMIPConfig *cfg, NMWrapperIPRoute *route, int size)
 {
-	NMIPConfig* cfg;
 	GPtrArray *ptr_array;
-	NMDevice *dev = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	dev = nm_client_get_device_by_iface(client, interface);
-	if(!dev) return -1;
-
-	cfg = nm_device_get_ip4_config(dev);
-	if(!cfg) return -1;
 
 	ptr_array = nm_ip_config_get_routes(cfg);
 	if (!ptr_array || (ptr_array->len == 0))
@@ -1742,7 +2506,22 @@ int libnm_wrapper_ipv4_get_route_information(libnm_wrapper_handle hd, const char
 		GET_ATTR(NM_IP_ROUTE_ATTRIBUTE_WINDOW,         route[i].window,         UINT32,   uint32, 0);
 	}
 
-	return size;
+	return size;
+}
+
+int libnm_wrapper_ipv4_get_route_information(libnm_wrapper_handle hd, const char *interface, const char *id, NMWrapperIPRoute *route, int size)
+{
+	NMIPConfig* cfg;
+	NMDevice *dev = NULL;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	dev = nm_client_get_device_by_iface(client, interface);
+	if(!dev) return -1;
+
+	cfg = nm_device_get_ip4_config(dev);
+	if(!cfg) return -1;
+
+	return get_routes(cfg, route, size);
 }
 
 int libnm_wrapper_get_active_ipv4_addresses(libnm_wrapper_handle hd, const char *interface, char *ip, int ip_len, char *gateway, int gateway_len, char *subnet, int subnet_len, char *dns_1, int dns1_len, char *dns_2, int dns2_len)
@@ -1824,31 +2603,17 @@ int libnm_wrapper_ipv4_get_dhcp_information(libnm_wrapper_handle hd, const char
 
 int libnm_wrapper_ipv4_set_method(libnm_wrapper_handle hd, const char *id, const char *value)
 {
-	NMRemoteConnection *remote;
-	NMSettingIPConfig *s_ip4;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	libnm_wrapper_transaction tr;
 
 	//"manual" will be set when ip address is set;
 	if(!strncmp(value, NM_SETTING_IP4_CONFIG_METHOD_MANUAL, strlen(NM_SETTING_IP4_CONFIG_METHOD_MANUAL)))
 		return LIBNM_WRAPPER_ERR_SUCCESS;
 
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip4 = nm_connection_get_setting_ip4_config (NM_CONNECTION(remote));
-	if(s_ip4)
-	{
-		g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_METHOD, value, NULL);
-		nm_setting_ip_config_clear_addresses(s_ip4);
-		nm_setting_ip_config_clear_dns(s_ip4);
-		nm_setting_ip_config_clear_routes(s_ip4);
-		g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_GATEWAY, NULL, NULL);
-
-		if(TRUE == nm_remote_connection_commit_changes(remote, TRUE, NULL, NULL))
-			return LIBNM_WRAPPER_ERR_SUCCESS;
-	}
+	tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	return LIBNM_WRAPPER_ERR_FAIL;
+	libnm_wrapper_transaction_stage_ipv4_method(tr, value);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv4_get_method(libnm_wrapper_handle hd , const char *id, char *method, int len)
@@ -1857,9 +2622,8 @@ int libnm_wrapper_ipv4_get_method(libnm_wrapper_handle hd , const char *id, char
 	int ret = LIBNM_WRAPPER_ERR_INVALID_CONFIG;
 	NMSettingIPConfig *s_ip4;
 	NMRemoteConnection *remote;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
@@ -1877,34 +2641,17 @@ int libnm_wrapper_ipv4_get_method(libnm_wrapper_handle hd , const char *id, char
 }
 
 int libnm_wrapper_ipv6_set_method(libnm_wrapper_handle hd , const char *id, const char * value){
-	GError *err = NULL;
-	NMRemoteConnection *remote;
-	NMSettingIPConfig *s_ip6;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	libnm_wrapper_transaction tr;
 
 	//"manual" will be set when ip address is set;
 	if(!strncmp(value, NM_SETTING_IP6_CONFIG_METHOD_MANUAL, strlen(NM_SETTING_IP6_CONFIG_METHOD_MANUAL)))
 		return LIBNM_WRAPPER_ERR_SUCCESS;
 
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	s_ip6 = nm_connection_get_setting_ip6_config (NM_CONNECTION(remote));
-	if(s_ip6)
-	{
-		g_object_set (s_ip6, NM_SETTING_IP_CONFIG_METHOD, value, NULL);
-		nm_setting_ip_config_clear_addresses(s_ip6);
-		nm_setting_ip_config_clear_dns(s_ip6);
-		nm_setting_ip_config_clear_routes(s_ip6);
-		g_object_set (G_OBJECT(NM_SETTING(s_ip6)), NM_SETTING_IP_CONFIG_GATEWAY, NULL, NULL);
-		if(TRUE == nm_remote_connection_commit_changes(remote, TRUE, NULL, &err))
-			return LIBNM_WRAPPER_ERR_SUCCESS;
-		if(err)
-		{
-			g_error_free (err);
-		}
-	}
-	return LIBNM_WRAPPER_ERR_FAIL;
+	libnm_wrapper_transaction_stage_ipv6_method(tr, value);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv6_get_method(libnm_wrapper_handle hd , const char *id, char *method, int len)
@@ -1913,9 +2660,8 @@ int libnm_wrapper_ipv6_get_method(libnm_wrapper_handle hd , const char *id, char
 	const char *ptr;
 	NMRemoteConnection *remote;
 	NMSettingIPConfig *s_ip6;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip6 = nm_connection_get_setting_ip6_config(NM_CONNECTION(remote));
@@ -1935,152 +2681,31 @@ int libnm_wrapper_ipv6_get_method(libnm_wrapper_handle hd , const char *id, char
 
 int libnm_wrapper_ipv4_set_address(libnm_wrapper_handle hd, const char *id, const int index, const char *address, const char *netmask, const char *gateway)
 {
-	GError *err = NULL;
-	NMIPAddress *addr;
-	NMRemoteConnection *remote = NULL;
-	NMSettingIPConfig *s_ip4 = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	remote = nm_client_get_connection_by_id(client , id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
-	if(!s_ip4)
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	//Force to "manual" method to set ip address
-	g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_METHOD, "manual", NULL);
-
-	if (nm_setting_ip_config_get_num_addresses(s_ip4) == 0)
-	{
-		addr = nm_ip_address_new(AF_INET, "192.168.1.1", 24, NULL);
-		nm_setting_ip_config_add_address(s_ip4, addr);
-		nm_ip_address_unref(addr);
-	}
-
-	if (index >= nm_setting_ip_config_get_num_addresses(s_ip4))
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	addr = nm_setting_ip_config_get_address(s_ip4, index);
-
-	if (address && address[0])
-		nm_ip_address_set_address(addr, address);
-
-	if (netmask && netmask[0])
-	{
-		int prefix = atoi(netmask);
-		if(prefix > 0 && prefix < 32)
-			nm_ip_address_set_prefix(addr, atoi(netmask));
-	}
-
-	if (gateway && gateway[0])
-		g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_GATEWAY, gateway, NULL);
-
-	if (FALSE == nm_connection_verify(NM_CONNECTION(remote), &err))
-	{
-		g_error_free (err);
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-	}
-
-	if(FALSE == nm_remote_connection_commit_changes(remote, TRUE, NULL, NULL))
-			return LIBNM_WRAPPER_ERR_FAIL;
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	return LIBNM_WRAPPER_ERR_SUCCESS;
+	libnm_wrapper_transaction_stage_ipv4_address(tr, index, address, netmask, gateway);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv4_set_all_addresses(libnm_wrapper_handle hd,
 	const char *id, const int index, const char *address,
 	const char *netmask, const char *gateway, const char* dns)
 {
-	GError *err = NULL;
-	NMIPAddress *addr;
-	NMRemoteConnection *remote = NULL;
-	NMSettingIPConfig *s_ip4 = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	GMainLoop *loop;
-	libnm_wrapper_cb_st *temp;
-	int result;
-
-	remote = nm_client_get_connection_by_id(client , id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
-	if (!s_ip4)
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	//Force to "manual" method to set ip address
-	g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_METHOD, "manual", NULL);
-
-	if (nm_setting_ip_config_get_num_addresses(s_ip4) == 0)
-	{
-		addr = nm_ip_address_new(AF_INET, "192.168.1.1", 24, NULL);
-		nm_setting_ip_config_add_address(s_ip4, addr);
-		nm_ip_address_unref(addr);
-	}
-
-	if (index >= nm_setting_ip_config_get_num_addresses(s_ip4))
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	addr = nm_setting_ip_config_get_address(s_ip4, index);
-
-	if (address && address[0])
-		nm_ip_address_set_address(addr, address);
-
-	if (netmask && netmask[0])
-	{
-		int prefix = atoi(netmask);
-		if(prefix > 0 && prefix < 32)
-			nm_ip_address_set_prefix(addr, atoi(netmask));
-	}
-
-	if (gateway && gateway[0])
-		g_object_set (G_OBJECT(NM_SETTING(s_ip4)), NM_SETTING_IP_CONFIG_GATEWAY, gateway, NULL);
-
-	nm_setting_ip_config_clear_dns(s_ip4);
-	if (dns && dns[0])
-	{
-		char * tokens;
-		char * dns_copy = strdup(dns);
-		if (!dns_copy)
-			return LIBNM_WRAPPER_ERR_FAIL;
-
-		tokens = strtok(dns_copy, " ");
-		while (tokens)
-		{
-			if (!nm_utils_ipaddr_valid(AF_INET, tokens))
-				return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
-			if (!nm_setting_ip_config_add_dns(s_ip4, tokens))
-				return LIBNM_WRAPPER_ERR_FAIL;
-
-			tokens = strtok(NULL," ");
-		}
-		free(dns_copy);
-	}
-
-	if (FALSE == nm_connection_verify(NM_CONNECTION(remote), &err))
-	{
-		g_error_free (err);
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-	}
-
-	loop = g_main_loop_new (NULL, FALSE);
-	temp = g_malloc0(sizeof(libnm_wrapper_cb_st));
-	temp->loop = loop;
-	temp->result = &result;
-
-	nm_remote_connection_commit_changes_async(remote, TRUE, NULL, remote_commit_cb, temp);
-	g_main_loop_run(loop);
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	return result;
+	libnm_wrapper_transaction_stage_ipv4_address(tr, index, address, netmask, gateway);
+	libnm_wrapper_transaction_stage_ipv4_dns(tr, dns);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv4_get_address_num(libnm_wrapper_handle hd, const char *id, int *num)
 {
 	NMSettingIPConfig *s_ip4;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client , id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
@@ -2097,9 +2722,8 @@ int libnm_wrapper_ipv4_get_address(libnm_wrapper_handle hd, const char *id,
 {
 	NMSettingIPConfig *s_ip4;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client , id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
@@ -2126,9 +2750,8 @@ int libnm_wrapper_ipv6_get_address_num(libnm_wrapper_handle hd, const char *id,
 {
 	NMSettingIPConfig *s_ip6;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client , id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip6 = nm_connection_get_setting_ip6_config(NM_CONNECTION(remote));
@@ -2143,9 +2766,8 @@ int libnm_wrapper_ipv6_get_address(libnm_wrapper_handle hd, const char *id, cons
 {
 	NMSettingIPConfig *s_ip6;
 	NMRemoteConnection *remote = NULL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client , id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip6 = nm_connection_get_setting_ip6_config(NM_CONNECTION(remote));
@@ -2170,84 +2792,20 @@ int libnm_wrapper_ipv6_get_address(libnm_wrapper_handle hd, const char *id, cons
 
 int libnm_wrapper_ipv6_set_address(libnm_wrapper_handle hd, const char *id, const int index, const char *address, const char *netmask, const char *gateway)
 {
-	NMIPAddress *addr;
-	NMRemoteConnection *remote;
-	NMSettingIPConfig *s_ip6;
-	int ret = LIBNM_WRAPPER_ERR_SUCCESS;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip6 = nm_connection_get_setting_ip6_config(NM_CONNECTION(remote));
-	if (!s_ip6)
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	//Force to "manual" method to set ip address
-	g_object_set (G_OBJECT(NM_SETTING(s_ip6)), NM_SETTING_IP_CONFIG_METHOD, "manual", NULL);
-
-	if (nm_setting_ip_config_get_num_addresses(s_ip6) == 0)
-	{
-		addr = nm_ip_address_new(AF_INET6, "::", 128, NULL);
-		nm_setting_ip_config_add_address(s_ip6, addr);
-		nm_ip_address_unref(addr);
-	}
-
-	if (index >= nm_setting_ip_config_get_num_addresses(s_ip6))
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	addr = nm_setting_ip_config_get_address(s_ip6, index);
-
-	if (address && address[0])
-		nm_ip_address_set_address(addr, address);
-
-	if (netmask && netmask[0])
-	{
-		int prefix = atoi(netmask);
-		if(prefix > 0)
-			nm_ip_address_set_prefix(addr, prefix);
-	}
-
-	if (gateway && gateway[0])
-		g_object_set(G_OBJECT(NM_SETTING(s_ip6)), NM_SETTING_IP_CONFIG_GATEWAY, gateway, NULL);
-
-	if (FALSE == nm_remote_connection_commit_changes(remote, TRUE, NULL, NULL))
-			return LIBNM_WRAPPER_ERR_FAIL;
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	return ret;
+	libnm_wrapper_transaction_stage_ipv6_address(tr, index, address, netmask, gateway);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv4_set_dns(libnm_wrapper_handle hd, const char *id, char *address)
 {
-	NMRemoteConnection *remote;
-	NMSettingIPConfig *s_ip4;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip4 = nm_connection_get_setting_ip4_config(NM_CONNECTION(remote));
-	if(!s_ip4)
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
-
-	nm_setting_ip_config_clear_dns(s_ip4);
-	if(address){
-		char * tokens;
-		tokens = strtok(address," ");
-		while( tokens != NULL )
-		{
-			if(nm_utils_ipaddr_valid(AF_INET, tokens) == FALSE)
-				return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
-			if(FALSE == nm_setting_ip_config_add_dns(s_ip4, tokens))
-				return LIBNM_WRAPPER_ERR_FAIL;
-			tokens = strtok(NULL," ");
-		}
-	}
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	if(FALSE == nm_remote_connection_commit_changes(remote, TRUE, NULL, NULL))
-			return LIBNM_WRAPPER_ERR_FAIL;
-
-	return LIBNM_WRAPPER_ERR_SUCCESS;
+	libnm_wrapper_transaction_stage_ipv4_dns(tr, address);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv4_get_dns(libnm_wrapper_handle hd, const char *id, char *address, int buff_len)
@@ -2257,9 +2815,8 @@ int libnm_wrapper_ipv4_get_dns(libnm_wrapper_handle hd, const char *id, char *ad
 	int num_dns, i, len = 0;
 	const char *dns = NULL;
 	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip4 = nm_connection_get_setting_ip4_config (NM_CONNECTION(remote));
@@ -2292,34 +2849,11 @@ int libnm_wrapper_ipv4_get_dns(libnm_wrapper_handle hd, const char *id, char *ad
 
 int libnm_wrapper_ipv6_set_dns(libnm_wrapper_handle hd, const char *id, char *address)
 {
-	NMRemoteConnection *remote;
-	NMSettingIPConfig *s_ip6;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	remote = nm_client_get_connection_by_id(client, id);
-	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
-
-	s_ip6 = nm_connection_get_setting_ip6_config (NM_CONNECTION(remote));
-	if(!s_ip6)
-		return LIBNM_WRAPPER_ERR_INVALID_CONFIG;
+	libnm_wrapper_transaction tr = libnm_wrapper_transaction_begin(hd, id);
+	nm_wrapper_assert(tr, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
-	nm_setting_ip_config_clear_dns(s_ip6);
-	if(address){
-		char * tokens;
-		tokens = strtok(address," ");
-		while( tokens != NULL)
-		{
-			if(nm_utils_ipaddr_valid(AF_INET6, tokens) == FALSE)
-				return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
-			if(FALSE == nm_setting_ip_config_add_dns(s_ip6, tokens))
-				return LIBNM_WRAPPER_ERR_FAIL;
-			tokens = strtok(NULL," ");
-		}
-	}
-
-	if(FALSE == nm_remote_connection_commit_changes(remote, TRUE, NULL, NULL))
-			return LIBNM_WRAPPER_ERR_FAIL;
-	return LIBNM_WRAPPER_ERR_SUCCESS;
+	libnm_wrapper_transaction_stage_ipv6_dns(tr, address);
+	return libnm_wrapper_transaction_commit(tr);
 }
 
 int libnm_wrapper_ipv6_get_dns(libnm_wrapper_handle hd, const char *id, char *address, int buff_len)
@@ -2329,9 +2863,8 @@ int libnm_wrapper_ipv6_get_dns(libnm_wrapper_handle hd, const char *id, char *ad
 	int num_dns, i, len = 0;
 	const char *dns = NULL;
 	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip6 = nm_connection_get_setting_ip6_config (NM_CONNECTION(remote));
@@ -2364,9 +2897,8 @@ int libnm_wrapper_ipv4_clear_address(libnm_wrapper_handle hd , const char *id)
 	NMRemoteConnection *remote;
 	NMSettingIPConfig *s_ip4;
 	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip4 = nm_connection_get_setting_ip4_config (NM_CONNECTION(remote));
@@ -2383,9 +2915,8 @@ int libnm_wrapper_ipv6_clear_address(libnm_wrapper_handle hd , const char *id)
 	NMRemoteConnection *remote;
 	NMSettingIPConfig *s_ip6;
 	int ret = LIBNM_WRAPPER_ERR_FAIL;
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 
-	remote = nm_client_get_connection_by_id(client, id);
+	remote = nm_wrapper_cache_get_connection_by_id(hd, id);
 	nm_wrapper_assert(remote, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
 
 	s_ip6 = nm_connection_get_setting_ip6_config(NM_CONNECTION(remote));
@@ -2496,6 +3027,162 @@ int libnm_wrapper_ipv6_enable_nat(libnm_wrapper_handle hd , const char *id)
 }
 /**@}*/
 
+/**
+ * @name Snapshot API
+ */
+/**@{*/
+static void get_ipv4_snapshot(NMActiveConnection *active, NMWrapperInterfaceSnapshot *dst)
+{
+	NMIPConfig *ip4;
+	NMIPAddress *a;
+	GPtrArray *addresses;
+	const char *ptr;
+	const char *const *dns;
+	int num;
+
+	ip4 = nm_active_connection_get_ip4_config(active);
+	if (!ip4)
+		return;
+
+	dst->has_ipv4 = 1;
+
+	addresses = nm_ip_config_get_addresses(ip4);
+	if (addresses && addresses->len)
+	{
+		a = g_ptr_array_index(addresses, 0);
+		safe_strncpy(dst->ipv4_address, nm_ip_address_get_address(a), LIBNM_WRAPPER_MAX_NAME_LEN);
+		dst->ipv4_prefix = nm_ip_address_get_prefix(a);
+		if (dst->ipv4_prefix > 0 && dst->ipv4_prefix <= 32)
+		{
+			unsigned long mask = (0xFFFFFFFF << (32 - dst->ipv4_prefix)) & 0xFFFFFFFF;
+			snprintf(dst->ipv4_subnet, LIBNM_WRAPPER_MAX_NAME_LEN, "%lu.%lu.%lu.%lu",
+				mask >> 24, (mask >> 16) & 0xFF, (mask >> 8) & 0xFF, mask & 0xFF);
+		}
+	}
+
+	ptr = nm_ip_config_get_gateway(ip4);
+	if (ptr)
+		safe_strncpy(dst->ipv4_gateway, ptr, LIBNM_WRAPPER_MAX_NAME_LEN);
+
+	dns = nm_ip_config_get_nameservers(ip4);
+	for (int i = 0; dns && dns[i] && i < LIBNM_WRAPPER_SNAPSHOT_MAX_DNS_NUM; i++)
+		safe_strncpy(dst->ipv4_dns[i], dns[i], LIBNM_WRAPPER_MAX_NAME_LEN);
+
+	num = get_routes(ip4, dst->routes, LIBNM_WRAPPER_SNAPSHOT_MAX_ROUTE_NUM);
+	dst->route_num = num > 0 ? num : 0;
+}
+
+static void get_dhcp4_snapshot(NMActiveConnection *active, NMWrapperInterfaceSnapshot *dst)
+{
+	GHashTableIter iter;
+	GHashTable *options;
+	const char *name, *value;
+	NMDhcpConfig *dhcp4 = nm_active_connection_get_dhcp4_config(active);
+
+	if (!dhcp4)
+		return;
+
+	options = nm_dhcp_config_get_options(dhcp4);
+	if (!options)
+		return;
+
+	g_hash_table_iter_init(&iter, options);
+	while (dst->dhcp_option_num < LIBNM_WRAPPER_SNAPSHOT_MAX_DHCP_NUM &&
+		g_hash_table_iter_next(&iter, (gpointer *)&name, (gpointer *)&value))
+	{
+		NMWrapperDhcpOption *o = &dst->dhcp_options[dst->dhcp_option_num++];
+		safe_strncpy(o->name, name, LIBNM_WRAPPER_MAX_NAME_LEN);
+		safe_strncpy(o->value, value, LIBNM_WRAPPER_MAX_NAME_LEN);
+	}
+}
+
+static void get_interface_snapshot(NMDevice *dev, NMWrapperInterfaceSnapshot *dst)
+{
+	NMRemoteConnection *remote;
+	NMActiveConnection *active;
+	NMAccessPoint *ap;
+
+	memset(dst, 0, sizeof(*dst));
+
+	safe_strncpy(dst->interface, nm_device_get_iface(dev), LIBNM_WRAPPER_MAX_NAME_LEN);
+	dst->type = nm_device_get_device_type(dev);
+	dst->state_reason = nm_device_get_state_reason(dev);
+	nm_wrapper_get_device_status(dev, &dst->device);
+
+	active = nm_device_get_active_connection(dev);
+	if (active)
+	{
+		dst->has_active = 1;
+		dst->active_state = nm_active_connection_get_state(active);
+		remote = nm_active_connection_get_connection(active);
+		if (remote)
+			safe_strncpy(dst->active_id, nm_connection_get_id(NM_CONNECTION(remote)), LIBNM_WRAPPER_MAX_NAME_LEN);
+
+		get_ipv4_snapshot(active, dst);
+		get_dhcp4_snapshot(active, dst);
+	}
+
+	if (NM_IS_DEVICE_WIFI(dev))
+	{
+		ap = nm_device_wifi_get_active_access_point(NM_DEVICE_WIFI(dev));
+		if (ap)
+		{
+			dst->has_ap = 1;
+			get_access_point_settings(ap, &dst->ap);
+		}
+	}
+}
+
+/**
+ * Get device, active connection, IPv4, route, DHCP and active AP state in
+ * one call.
+ * The client state only changes while its main context is iterated, so all
+ * entries are taken from the same point in time.
+ * @param hd: library handle
+ * @param interface: which device, NULL for all devices
+ * @param snapshot: buffer of LIBNM_WRAPPER_SNAPSHOT_SIZE(size) bytes
+ * @param size: number of interface entries the buffer holds
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_get_snapshot(libnm_wrapper_handle hd, const char *interface, NMWrapperSnapshot *snapshot, int size)
+{
+	NMDevice *dev;
+	const GPtrArray *devices;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	nm_wrapper_assert(snapshot, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	if (snapshot->version != LIBNM_WRAPPER_SNAPSHOT_VERSION || size < 0)
+		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+
+	snapshot->num = 0;
+	snapshot->total = 0;
+
+	if (interface)
+	{
+		dev = nm_client_get_device_by_iface(client, interface);
+		if (!dev)
+			return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+		snapshot->total = 1;
+		if (size > 0)
+			get_interface_snapshot(dev, &snapshot->interfaces[snapshot->num++]);
+		return LIBNM_WRAPPER_ERR_SUCCESS;
+	}
+
+	devices = nm_client_get_devices(client);
+	for (int i = 0; devices && i < devices->len; i++)
+	{
+		dev = g_ptr_array_index(devices, i);
+		if (snapshot->num < size)
+			get_interface_snapshot(dev, &snapshot->interfaces[snapshot->num++]);
+		snapshot->total++;
+	}
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+/**@}*/
+
 /**
  * @name Misc API
  */
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libnm_wrapper_internal.h"
+
+/**
+ * Connection lookup cache.
+ * Connections are indexed by id, uuid and interface name. The indexes follow
+ * the client's connection-added/connection-removed signals and each
+ * connection's "changed" signal, so they are as current as the client itself.
+ */
+
+typedef struct _nm_wrapper_cache_entry
+{
+	NMRemoteConnection *remote;
+	char *id;
+	char *uuid;
+	char *iface;
+	gulong changed_id;
+} nm_wrapper_cache_entry;
+
+struct _nm_wrapper_cache_st
+{
+	NMClient *client;
+	// NMRemoteConnection -> nm_wrapper_cache_entry
+	GHashTable *entries;
+	// id -> NMRemoteConnection, first connection wins on duplicated ids
+	GHashTable *by_id;
+	// uuid -> NMRemoteConnection
+	GHashTable *by_uuid;
+	// interface -> GPtrArray of NMRemoteConnection
+	GHashTable *by_iface;
+	gulong added_id;
+	gulong removed_id;
+};
+
+static void cache_index_add(nm_wrapper_cache_st *cache, nm_wrapper_cache_entry *e)
+{
+	GPtrArray *array;
+	NMSettingConnection *s_con = nm_connection_get_setting_connection(NM_CONNECTION(e->remote));
+
+	if (!s_con)
+		return;
+
+	e->id = g_strdup(nm_setting_connection_get_id(s_con));
+	e->uuid = g_strdup(nm_setting_connection_get_uuid(s_con));
+	e->iface = g_strdup(nm_setting_connection_get_interface_name(s_con));
+
+	if (e->id && !g_hash_table_contains(cache->by_id, e->id))
+		g_hash_table_insert(cache->by_id, e->id, e->remote);
+
+	if (e->uuid)
+		g_hash_table_insert(cache->by_uuid, e->uuid, e->remote);
+
+	if (e->iface)
+	{
+		array = g_hash_table_lookup(cache->by_iface, e->iface);
+		if (!array)
+		{
+			array = g_ptr_array_new();
+			g_hash_table_insert(cache->by_iface, g_strdup(e->iface), array);
+		}
+		g_ptr_array_add(array, e->remote);
+	}
+}
+
+static void cache_index_remove(nm_wrapper_cache_st *cache, nm_wrapper_cache_entry *e)
+{
+	GHashTableIter iter;
+	GPtrArray *array;
+	nm_wrapper_cache_entry *other;
+
+	if (e->id && g_hash_table_lookup(cache->by_id, e->id) == e->remote)
+	{
+		g_hash_table_remove(cache->by_id, e->id);
+
+		// Promote another connection sharing the same id, if any
+		g_hash_table_iter_init(&iter, cache->entries);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&other))
+		{
+			if (other != e && other->id && !strcmp(other->id, e->id))
+			{
+				g_hash_table_insert(cache->by_id, other->id, other->remote);
+				break;
+			}
+		}
+	}
+
+	if (e->uuid && g_hash_table_lookup(cache->by_uuid, e->uuid) == e->remote)
+		g_hash_table_remove(cache->by_uuid, e->uuid);
+
+	if (e->iface)
+	{
+		array = g_hash_table_lookup(cache->by_iface, e->iface);
+		if (array)
+		{
+			g_ptr_array_remove(array, e->remote);
+			if (!array->len)
+				g_hash_table_remove(cache->by_iface, e->iface);
+		}
+	}
+
+	g_clear_pointer(&e->id, g_free);
+	g_clear_pointer(&e->uuid, g_free);
+	g_clear_pointer(&e->iface, g_free);
+}
+
+static void connection_changed(NMConnection *connection, gpointer user_data)
+{
+	nm_wrapper_cache_st *cache = (nm_wrapper_cache_st *)user_data;
+	nm_wrapper_cache_entry *e = g_hash_table_lookup(cache->entries, connection);
+
+	if (!e)
+		return;
+
+	cache_index_remove(cache, e);
+	cache_index_add(cache, e);
+}
+
+static void cache_add(nm_wrapper_cache_st *cache, NMRemoteConnection *remote)
+{
+	nm_wrapper_cache_entry *e;
+
+	if (g_hash_table_contains(cache->entries, remote))
+		return;
+
+	e = g_malloc0(sizeof(nm_wrapper_cache_entry));
+	e->remote = g_object_ref(remote);
+	e->changed_id = g_signal_connect(remote, NM_CONNECTION_CHANGED,
+		G_CALLBACK(connection_changed), cache);
+
+	g_hash_table_insert(cache->entries, remote, e);
+	cache_index_add(cache, e);
+}
+
+static void cache_entry_free(nm_wrapper_cache_st *cache, nm_wrapper_cache_entry *e)
+{
+	g_signal_handler_disconnect(e->remote, e->changed_id);
+	cache_index_remove(cache, e);
+	g_object_unref(e->remote);
+	g_free(e);
+}
+
+static void cache_remove(nm_wrapper_cache_st *cache, NMRemoteConnection *remote)
+{
+	nm_wrapper_cache_entry *e = g_hash_table_lookup(cache->entries, remote);
+
+	if (!e)
+		return;
+
+	g_hash_table_remove(cache->entries, remote);
+	cache_entry_free(cache, e);
+}
+
+static void client_connection_added(NMClient *client, NMRemoteConnection *remote, gpointer user_data)
+{
+	cache_add((nm_wrapper_cache_st *)user_data, remote);
+}
+
+static void client_connection_removed(NMClient *client, NMRemoteConnection *remote, gpointer user_data)
+{
+	cache_remove((nm_wrapper_cache_st *)user_data, remote);
+}
+
+/**
+ * Create the connection cache of a client.
+ * @param client: point to NetworkManager client
+ *
+ * Returns: connection cache
+ */
+nm_wrapper_cache_st *nm_wrapper_cache_new(NMClient *client)
+{
+	const GPtrArray *connections;
+	nm_wrapper_cache_st *cache = g_malloc0(sizeof(nm_wrapper_cache_st));
+
+	cache->client = client;
+	cache->entries = g_hash_table_new(g_direct_hash, g_direct_equal);
+	cache->by_id = g_hash_table_new(g_str_hash, g_str_equal);
+	cache->by_uuid = g_hash_table_new(g_str_hash, g_str_equal);
+	cache->by_iface = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) g_ptr_array_unref);
+
+	connections = nm_client_get_connections(client);
+	for (int i = 0; connections && i < connections->len; i++)
+		cache_add(cache, NM_REMOTE_CONNECTION(connections->pdata[i]));
+
+	cache->added_id = g_signal_connect(client, NM_CLIENT_CONNECTION_ADDED,
+		G_CALLBACK(client_connection_added), cache);
+	cache->removed_id = g_signal_connect(client, NM_CLIENT_CONNECTION_REMOVED,
+		G_CALLBACK(client_connection_removed), cache);
+
+	return cache;
+}
+
+/**
+ * Destroy a connection cache.
+ * @param cache: connection cache
+ */
+void nm_wrapper_cache_free(nm_wrapper_cache_st *cache)
+{
+	GHashTableIter iter;
+	nm_wrapper_cache_entry *e;
+
+	if (!cache)
+		return;
+
+	g_signal_handler_disconnect(cache->client, cache->added_id);
+	g_signal_handler_disconnect(cache->client, cache->removed_id);
+
+	// Indexes only borrow from the entries, drop them before the entries
+	g_hash_table_unref(cache->by_id);
+	g_hash_table_unref(cache->by_uuid);
+	g_hash_table_unref(cache->by_iface);
+
+	g_hash_table_iter_init(&iter, cache->entries);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&e))
+	{
+		g_signal_handler_disconnect(e->remote, e->changed_id);
+		g_object_unref(e->remote);
+		g_free(e->id);
+		g_free(e->uuid);
+		g_free(e->iface);
+		g_free(e);
+	}
+
+	g_hash_table_unref(cache->entries);
+	g_free(cache);
+}
+
+/**
+ * Look up a connection by id.
+ * @param hd: library handle
+ * @param id: connection id
+ *
+ * Returns: the connection, NULL if not found
+ */
+NMRemoteConnection *nm_wrapper_cache_get_connection_by_id(libnm_wrapper_handle hd, const char *id)
+{
+	nm_wrapper_cache_st *cache = ((libnm_wrapper_handle_st *)hd)->cache;
+
+	if (!id)
+		return NULL;
+	return g_hash_table_lookup(cache->by_id, id);
+}
+
+/**
+ * Look up a connection by uuid.
+ * @param hd: library handle
+ * @param uuid: connection uuid
+ *
+ * Returns: the connection, NULL if not found
+ */
+NMRemoteConnection *nm_wrapper_cache_get_connection_by_uuid(libnm_wrapper_handle hd, const char *uuid)
+{
+	nm_wrapper_cache_st *cache = ((libnm_wrapper_handle_st *)hd)->cache;
+
+	if (!uuid)
+		return NULL;
+	return g_hash_table_lookup(cache->by_uuid, uuid);
+}
+
+/**
+ * Look up the connections bound to an interface.
+ * @param hd: library handle
+ * @param interface: interface name
+ *
+ * Returns: array of NMRemoteConnection, NULL if there is none
+ */
+const GPtrArray *nm_wrapper_cache_get_connections_by_interface(libnm_wrapper_handle hd, const char *interface)
+{
+	nm_wrapper_cache_st *cache = ((libnm_wrapper_handle_st *)hd)->cache;
+
+	if (!interface)
+		return NULL;
+	return g_hash_table_lookup(cache->by_iface, interface);
+}
@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+#include <glib-unix.h>
+#include "nl80211_cqm.h"
+#include "libnm_wrapper_internal.h"
+
+/**
+ * Connection quality monitor.
+ * The thresholds are set with NL80211_CMD_SET_CQM on a request socket, the
+ * NL80211_CMD_NOTIFY_CQM notifications are read by the nl80211_cqm_monitor
+ * of the netlink examples, whose socket is attached to the main context of
+ * the handle.
+ */
+
+typedef struct _libnm_wrapper_cqm_st
+{
+	GMainContext *context;
+	GSource *source;
+	struct nl80211_state req;
+	struct nl80211_cqm_monitor mon;
+	char interface[LIBNM_WRAPPER_MAX_NAME_LEN];
+	LIBNM_WRAPPER_CQM_CALLBACK callback;
+	void *user_data;
+	// The callback may stop the monitor, it is then freed after the dispatch
+	bool dispatching;
+	bool stopped;
+} libnm_wrapper_cqm_st;
+
+static void cqm_free(libnm_wrapper_cqm_st *cqm)
+{
+	if (cqm->source)
+	{
+		g_source_destroy(cqm->source);
+		g_source_unref(cqm->source);
+	}
+	nl80211_cqm_monitor_close(&cqm->mon);
+	nl80211_cleanup(&cqm->req);
+	g_main_context_unref(cqm->context);
+	g_free(cqm);
+}
+
+static void cqm_event(const struct nl80211_cqm_event *ev, void *user_data)
+{
+	libnm_wrapper_cqm_st *cqm = (libnm_wrapper_cqm_st *)user_data;
+	NMWrapperCqmEvent event;
+
+	if (cqm->stopped)
+		return;
+
+	memset(&event, 0, sizeof(event));
+	switch (ev->type)
+	{
+		case NL80211_CQM_EVENT_RSSI_LOW:
+			event.type = LIBNM_WRAPPER_CQM_RSSI_LOW;
+			break;
+		case NL80211_CQM_EVENT_RSSI_HIGH:
+			event.type = LIBNM_WRAPPER_CQM_RSSI_HIGH;
+			break;
+		case NL80211_CQM_EVENT_BEACON_LOSS:
+			event.type = LIBNM_WRAPPER_CQM_BEACON_LOSS;
+			break;
+		case NL80211_CQM_EVENT_PACKET_LOSS:
+			event.type = LIBNM_WRAPPER_CQM_PACKET_LOSS;
+			break;
+		default:
+			return;
+	}
+	safe_strncpy(event.interface, cqm->interface, LIBNM_WRAPPER_MAX_NAME_LEN);
+	event.rssi = ev->rssi;
+	event.packets = ev->packets;
+
+	cqm->callback(&event, cqm->user_data);
+}
+
+static gboolean cqm_readable(gint fd, GIOCondition condition, gpointer user_data)
+{
+	libnm_wrapper_cqm_st *cqm = (libnm_wrapper_cqm_st *)user_data;
+
+	cqm->dispatching = true;
+	nl80211_cqm_monitor_dispatch(&cqm->mon);
+	cqm->dispatching = false;
+
+	if (cqm->stopped)
+	{
+		cqm_free(cqm);
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * @name Connection Quality Monitor API
+ */
+/**@{*/
+/**
+ * Monitor the signal of the link of a client interface.
+ * @param hd: library handle
+ * @param interface: wifi interface name
+ * @param thresholds: RSSI thresholds in dBm
+ * @param num_thresholds: number of thresholds, 1 to LIBNM_WRAPPER_CQM_MAX_THRESHOLDS
+ * @param hysteresis: hysteresis in dB, applies to a single threshold
+ * @param callback: called on the handle's context for every crossing and
+ *                  every beacon or packet loss event
+ * @param user_data: user data passed to callback
+ *
+ * Returns: monitor, NULL if unsuccessful
+ */
+libnm_wrapper_cqm libnm_wrapper_cqm_start(libnm_wrapper_handle hd, const char *interface,
+	const int *thresholds, int num_thresholds, unsigned int hysteresis,
+	LIBNM_WRAPPER_CQM_CALLBACK callback, void *user_data)
+{
+	libnm_wrapper_cqm_st *cqm;
+	int ifindex;
+
+	nm_wrapper_assert(hd, NULL)
+	nm_wrapper_assert(interface, NULL)
+	nm_wrapper_assert(thresholds, NULL)
+	nm_wrapper_assert(callback, NULL)
+
+	if (num_thresholds < 1 || num_thresholds > LIBNM_WRAPPER_CQM_MAX_THRESHOLDS)
+		return NULL;
+
+	ifindex = if_nametoindex(interface);
+	if (!ifindex)
+		return NULL;
+
+	cqm = g_malloc0(sizeof(libnm_wrapper_cqm_st));
+	cqm->context = g_main_context_ref(handle_context(hd, NULL));
+	safe_strncpy(cqm->interface, interface, LIBNM_WRAPPER_MAX_NAME_LEN);
+	cqm->callback = callback;
+	cqm->user_data = user_data;
+
+	if (nl80211_init(&cqm->req))
+		goto fail;
+
+	// Listen first so no crossing reported right after the thresholds are set is missed
+	if (nl80211_cqm_monitor_init(&cqm->mon, ifindex, cqm_event, cqm))
+		goto fail;
+
+	if (nl80211_cqm_set_rssi(&cqm->req, ifindex, thresholds, num_thresholds, hysteresis))
+		goto fail;
+
+	cqm->source = g_unix_fd_source_new(nl80211_cqm_monitor_get_fd(&cqm->mon), G_IO_IN);
+	g_source_set_callback(cqm->source, (GSourceFunc)cqm_readable, cqm, NULL);
+	g_source_attach(cqm->source, cqm->context);
+
+	return (libnm_wrapper_cqm) cqm;
+
+fail:
+	cqm_free(cqm);
+	return NULL;
+}
+
+/**
+ * Stop a monitor and clear the thresholds of its interface.
+ * @param cqm: monitor
+ */
+void libnm_wrapper_cqm_stop(libnm_wrapper_cqm cqm)
+{
+	libnm_wrapper_cqm_st *st = (libnm_wrapper_cqm_st *)cqm;
+
+	if (!st || st->stopped)
+		return;
+
+	nl80211_cqm_set_rssi(&st->req, st->mon.ifindex, NULL, 0, 0);
+
+	st->stopped = true;
+	if (!st->dispatching)
+		cqm_free(st);
+}
+/**@}*/
@@ -12,26 +12,17 @@
  */
 /**@{*/
 /**
- * Get device status.
- * @param hd: library handle
- * @param interface: which device
+ * Fill device status from a device.
+ * @param dev: device
  * @param status: location to store status
- *
- * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
  */
-int libnm_wrapper_device_get_status(libnm_wrapper_handle hd, const char *interface, NMWrapperDevice* status)
+void nm_wrapper_get_device_status(NMDevice *dev, NMWrapperDevice *status)
 {
 	const char *ptr = NULL;
 	GPtrArray *ptr_array = NULL;
 	NMIPConfig *s_ip = NULL;
 	int num_ips;
 
-	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-
-	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
-	if(!dev)
-		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
-
 	status->autoconnect = false;
 	if (nm_device_get_autoconnect(dev))
 		status->autoconnect = true;
@@ -71,7 +62,25 @@ int libnm_wrapper_device_get_status(libnm_wrapper_handle hd, const char *interfa
 			safe_strncpy(status->addr6[i], nm_ip_address_get_address(a), LIBNM_WRAPPER_MAX_NAME_LEN);
 		}
 	}
+}
 
+/**
+ * Get device status.
+ * @param hd: library handle
+ * @param interface: which device
+ * @param status: location to store status
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_get_status(libnm_wrapper_handle hd, const char *interface, NMWrapperDevice* status)
+{
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
+	if(!dev)
+		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+	nm_wrapper_get_device_status(dev, status);
 	return LIBNM_WRAPPER_ERR_SUCCESS;
 }
 
@@ -141,6 +150,159 @@ int libnm_wrapper_device_disconnect(libnm_wrapper_handle hd,
 	return LIBNM_WRAPPER_ERR_FAIL;
 }
 
+/**
+ * Radio, networking and managed toggles complete when the matching property
+ * of the client or device reports the requested value, or fail when the
+ * deadline expires first.
+ */
+#define TOGGLE_TIMEOUT_MS	10000
+
+typedef struct _toggle_st
+{
+	GObject *object;
+	bool (*get)(GObject *object);
+	bool wanted;
+	GMainContext *context;
+	GSource *deadline;
+	// Cancelled once the toggle is done, a pending request must not touch it
+	GCancellable *cancellable;
+	gulong handler;
+	int result;
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback;
+	void *user_data;
+} toggle_st;
+
+static gboolean toggle_complete(gpointer user_data)
+{
+	toggle_st *t = (toggle_st *)user_data;
+
+	if (t->callback)
+		t->callback(t->result, t->user_data);
+	g_main_context_unref(t->context);
+	g_free(t);
+	return G_SOURCE_REMOVE;
+}
+
+static void toggle_stop(toggle_st *t)
+{
+	g_signal_handler_disconnect(t->object, t->handler);
+	g_source_destroy(t->deadline);
+	g_source_unref(t->deadline);
+	g_cancellable_cancel(t->cancellable);
+	g_object_unref(t->cancellable);
+	g_object_unref(t->object);
+}
+
+static void toggle_finish(toggle_st *t, int result)
+{
+	toggle_stop(t);
+	t->result = result;
+	// Complete on the caller's context, which may differ from the client's
+	g_main_context_invoke(t->context, toggle_complete, t);
+}
+
+static void toggle_notify(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	toggle_st *t = (toggle_st *)user_data;
+
+	if (t->get(object) == t->wanted)
+		toggle_finish(t, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+static gboolean toggle_deadline(gpointer user_data)
+{
+	toggle_finish((toggle_st *)user_data, LIBNM_WRAPPER_ERR_FAIL);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Start waiting for a property to reach a value.
+ * Must be called before the value is requested so no notification is missed,
+ * and followed by toggle_check() once it is.
+ */
+static toggle_st *toggle_new(libnm_wrapper_handle hd, GObject *object, const char *property,
+	bool (*get)(GObject *object), bool wanted, GMainContext *context,
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	char *signal = g_strconcat("notify::", property, NULL);
+	toggle_st *t = g_malloc0(sizeof(toggle_st));
+
+	t->object = g_object_ref(object);
+	t->get = get;
+	t->wanted = wanted;
+	t->context = g_main_context_ref(handle_context(hd, context));
+	t->callback = callback;
+	t->user_data = user_data;
+	t->cancellable = g_cancellable_new();
+	t->handler = g_signal_connect(object, signal, G_CALLBACK(toggle_notify), t);
+	g_free(signal);
+
+	// Notifications are emitted on the client's context, so is the deadline
+	t->deadline = g_timeout_source_new(TOGGLE_TIMEOUT_MS);
+	g_source_set_callback(t->deadline, toggle_deadline, t, NULL);
+	g_source_attach(t->deadline, handle_context(hd, NULL));
+
+	return t;
+}
+
+static void toggle_check(toggle_st *t)
+{
+	if (t->get(t->object) == t->wanted)
+		toggle_finish(t, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+#if !NM_CHECK_VERSION(1, 24, 0)
+static void toggle_cancel(toggle_st *t)
+{
+	toggle_stop(t);
+	g_main_context_unref(t->context);
+	g_free(t);
+}
+#endif
+
+static bool wireless_enabled(GObject *object)
+{
+	return nm_client_wireless_get_enabled(NM_CLIENT(object));
+}
+
+static bool wwan_enabled(GObject *object)
+{
+	return nm_client_wwan_get_enabled(NM_CLIENT(object));
+}
+
+static bool networking_enabled(GObject *object)
+{
+	return nm_client_networking_get_enabled(NM_CLIENT(object));
+}
+
+static bool device_managed(GObject *object)
+{
+	return nm_device_get_managed(NM_DEVICE(object));
+}
+
+/**
+ * Enables or disables wireless devices asynchronously.
+ * @param hd: library handle
+ * @param enable: whether to enable wireless
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: called once the state is reported by NetworkManager
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_wireless_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	toggle_st *t;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+
+	t = toggle_new(hd, G_OBJECT(client), NM_CLIENT_WIRELESS_ENABLED, wireless_enabled,
+		enable, context, callback, user_data);
+	nm_client_wireless_set_enabled(client, enable);
+	toggle_check(t);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
 /**
  * Enables or disables wireless devices.
  * @param hd: library handle
@@ -149,31 +311,187 @@ int libnm_wrapper_device_disconnect(libnm_wrapper_handle hd,
  */
 int libnm_wrapper_device_enable_wireless(libnm_wrapper_handle hd , bool enable)
 {
-	int state;
+	int ret;
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	ret = sync_wait(&sync, libnm_wrapper_device_enable_wireless_async(hd, enable,
+		NULL, sync_done_cb, &sync));
+
+	if (ret != LIBNM_WRAPPER_ERR_SUCCESS)
+		printf("%s: WARNING! wireless state remains %d!\n", __func__, !enable);
+	return ret;
+}
+
+/**
+ * Enables or disables WWAN devices asynchronously.
+ * @param hd: library handle
+ * @param enable: whether to enable WWAN
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: called once the state is reported by NetworkManager
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_wwan_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	toggle_st *t;
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
-	int count = 0;
-	bool processed;
 
-	nm_client_wireless_set_enabled(client, enable);
-	// Ensure state change is reflected in nm_client_wireless_get_enabled()
-	// before returning
-	do {
-		processed = g_main_context_iteration(NULL, FALSE);
-		state = nm_client_wireless_get_enabled(client);
-		if (state != enable && !processed) {
-			// Yield if there were no events ready to be processed and state
-			// has not yet changed
-			usleep(50*1000);
-		}
-	} while ((state != enable) && (count++ < 200));
+	t = toggle_new(hd, G_OBJECT(client), NM_CLIENT_WWAN_ENABLED, wwan_enabled,
+		enable, context, callback, user_data);
+	nm_client_wwan_set_enabled(client, enable);
+	toggle_check(t);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
 
-	if (state != enable) {
-		printf("%s: WARNING! wireless state remains %d!\n", __func__, state);
+/**
+ * Enables or disables WWAN devices.
+ * @param hd: library handle
+ * @param enable: whether to enable WWAN
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_enable_wwan(libnm_wrapper_handle hd, bool enable)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_device_enable_wwan_async(hd, enable,
+		NULL, sync_done_cb, &sync));
+}
+
+#if NM_CHECK_VERSION(1, 24, 0)
+static void networking_enable_cb(GObject *client, GAsyncResult *result, gpointer user_data)
+{
+	GError *error = NULL;
+	GVariant *ret;
+	toggle_st *t;
+
+	ret = nm_client_dbus_call_finish(NM_CLIENT(client), result, &error);
+	if (ret)
+	{
+		// The toggle completes on the property notification
+		g_variant_unref(ret);
+		return;
+	}
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	{
+		g_error_free(error);
+		return;
+	}
+	g_error_free(error);
+
+	t = (toggle_st *)user_data;
+	toggle_finish(t, t->get(t->object) == t->wanted ?
+		LIBNM_WRAPPER_ERR_SUCCESS : LIBNM_WRAPPER_ERR_FAIL);
+}
+#endif
+
+/**
+ * Enables or disables networking asynchronously.
+ * With NetworkManager older than 1.24 the request itself is synchronous
+ * and blocks until the daemon replies.
+ * @param hd: library handle
+ * @param enable: whether to enable networking
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: called once the state is reported by NetworkManager
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_enable_networking_async(libnm_wrapper_handle hd, bool enable,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	toggle_st *t;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+#if !NM_CHECK_VERSION(1, 24, 0)
+	GError *error = NULL;
+#endif
+
+	t = toggle_new(hd, G_OBJECT(client), NM_CLIENT_NETWORKING_ENABLED, networking_enabled,
+		enable, context, callback, user_data);
+#if NM_CHECK_VERSION(1, 24, 0)
+	context_push(handle_context(hd, NULL));
+	nm_client_dbus_call(client, NM_DBUS_PATH, NM_DBUS_INTERFACE, "Enable",
+		g_variant_new("(b)", enable), G_VARIANT_TYPE("()"), -1,
+		t->cancellable, networking_enable_cb, t);
+	context_pop(handle_context(hd, NULL));
+#else
+	if (!nm_client_networking_set_enabled(client, enable, &error))
+	{
+		g_error_free(error);
+		toggle_cancel(t);
 		return LIBNM_WRAPPER_ERR_FAIL;
 	}
+#endif
+	toggle_check(t);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Enables or disables networking.
+ * @param hd: library handle
+ * @param enable: whether to enable networking
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_enable_networking(libnm_wrapper_handle hd, bool enable)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_device_enable_networking_async(hd, enable,
+		NULL, sync_done_cb, &sync));
+}
+
+/**
+ * Set whether a device is managed by NetworkManager asynchronously.
+ * @param hd: library handle
+ * @param interface: which device
+ * @param managed: whether the device is managed
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: called once the state is reported by NetworkManager
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the operation was started
+ */
+int libnm_wrapper_device_set_managed_async(libnm_wrapper_handle hd, const char *interface, bool managed,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	toggle_st *t;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
+
+	if (!dev)
+		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+	t = toggle_new(hd, G_OBJECT(dev), NM_DEVICE_MANAGED, device_managed,
+		managed, context, callback, user_data);
+	nm_device_set_managed(dev, managed);
+	toggle_check(t);
 	return LIBNM_WRAPPER_ERR_SUCCESS;
 }
 
+/**
+ * Set whether a device is managed by NetworkManager.
+ * @param hd: library handle
+ * @param interface: which device
+ * @param managed: whether the device is managed
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_device_set_managed(libnm_wrapper_handle hd, const char *interface, bool managed)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_device_set_managed_async(hd, interface, managed,
+		NULL, sync_done_cb, &sync));
+}
+
 /**
  * Determines whether wireless devices are enabled
  * @param hd: library handle
@@ -253,9 +571,11 @@ int libnm_wrapper_device_state_monitor(libnm_wrapper_handle hd, const char *inte
 	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
 	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
 	g_signal_connect (dev, "notify::" NM_DEVICE_STATE, G_CALLBACK (device_state), user);
-	loop = g_main_loop_new (NULL, FALSE);
+	loop = g_main_loop_new (handle_context(hd, NULL), FALSE);
 	user->arg = (void *)loop;
 	g_main_loop_run (loop);
+	g_signal_handlers_disconnect_by_func(dev, G_CALLBACK (device_state), user);
+	g_main_loop_unref (loop);
 	return LIBNM_WRAPPER_ERR_SUCCESS;
 }
 
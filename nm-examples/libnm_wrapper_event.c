@@ -0,0 +1,487 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "libnm_wrapper_internal.h"
+
+typedef struct _libnm_wrapper_subscription_st
+{
+	// NULL once cancelled or once the handle is destroyed
+	libnm_wrapper_handle_st *st;
+	GMainContext *context;
+	unsigned int mask;
+	char *interface;
+	unsigned int coalesce_ms;
+	LIBNM_WRAPPER_EVENT_CALLBACK callback;
+	void *user_data;
+	// Queued events, changes on the same object are merged in place
+	GArray *pending;
+	GSource *timer;
+	int fd;
+	int ref;
+	bool cancelled;
+	// NMDevice -> device_watch_st
+	GHashTable *devices;
+	// NMActiveConnection -> active_watch_st
+	GHashTable *actives;
+} libnm_wrapper_subscription_st;
+
+typedef struct _device_watch_st
+{
+	libnm_wrapper_subscription_st *sub;
+	NMDevice *dev;
+	NMIPConfig *ip4;
+	NMIPConfig *ip6;
+} device_watch_st;
+
+typedef struct _active_watch_st
+{
+	libnm_wrapper_subscription_st *sub;
+	NMActiveConnection *active;
+} active_watch_st;
+
+static void subscription_unref(libnm_wrapper_subscription_st *sub)
+{
+	if (--sub->ref)
+		return;
+
+	g_array_unref(sub->pending);
+	if (sub->fd >= 0)
+		close(sub->fd);
+	g_free(sub->interface);
+	g_main_context_unref(sub->context);
+	g_free(sub);
+}
+
+static void event_flush(libnm_wrapper_subscription_st *sub)
+{
+	GArray *events;
+	uint64_t one = 1;
+
+	if (!sub->pending->len)
+		return;
+
+	if (!sub->callback)
+	{
+		// A failed write means the counter is already set, the fd is readable anyway
+		(void)!write(sub->fd, &one, sizeof(one));
+		return;
+	}
+
+	// The callback may unsubscribe, keep the subscription alive meanwhile
+	events = sub->pending;
+	sub->pending = g_array_new(FALSE, FALSE, sizeof(NMWrapperEvent));
+	sub->ref++;
+	for (int i = 0; i < events->len && !sub->cancelled; i++)
+		sub->callback(&g_array_index(events, NMWrapperEvent, i), sub->user_data);
+	g_array_unref(events);
+	subscription_unref(sub);
+}
+
+static gboolean event_timeout(gpointer user_data)
+{
+	libnm_wrapper_subscription_st *sub = (libnm_wrapper_subscription_st *)user_data;
+
+	g_source_unref(sub->timer);
+	sub->timer = NULL;
+	event_flush(sub);
+	return G_SOURCE_REMOVE;
+}
+
+static void event_post(libnm_wrapper_subscription_st *sub, unsigned int type,
+	const char *interface, const char *id, int state, int reason)
+{
+	NMWrapperEvent *e;
+	NMWrapperEvent event;
+
+	if (!(sub->mask & type))
+		return;
+
+	if (sub->interface && (!interface || strcmp(sub->interface, interface)))
+		return;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.state = state;
+	event.reason = reason;
+	event.count = 1;
+	safe_strncpy(event.interface, interface, LIBNM_WRAPPER_MAX_NAME_LEN);
+	safe_strncpy(event.id, id, LIBNM_WRAPPER_MAX_NAME_LEN);
+
+	for (int i = 0; i < sub->pending->len; i++)
+	{
+		e = &g_array_index(sub->pending, NMWrapperEvent, i);
+		if (e->type == type && !strcmp(e->interface, event.interface) && !strcmp(e->id, event.id))
+		{
+			e->state = state;
+			e->reason = reason;
+			e->count++;
+			goto schedule;
+		}
+	}
+	g_array_append_val(sub->pending, event);
+
+schedule:
+	if (!sub->coalesce_ms)
+	{
+		event_flush(sub);
+	}
+	else if (!sub->timer)
+	{
+		sub->timer = g_timeout_source_new(sub->coalesce_ms);
+		g_source_set_callback(sub->timer, event_timeout, sub, NULL);
+		g_source_attach(sub->timer, sub->context);
+	}
+}
+
+static const char *active_connection_interface(NMActiveConnection *active)
+{
+	const GPtrArray *devices = nm_active_connection_get_devices(active);
+
+	if (!devices || !devices->len)
+		return NULL;
+	return nm_device_get_iface(g_ptr_array_index(devices, 0));
+}
+
+static const char *connection_interface(NMRemoteConnection *remote)
+{
+	NMSettingConnection *s_con = nm_connection_get_setting_connection(NM_CONNECTION(remote));
+
+	return s_con ? nm_setting_connection_get_interface_name(s_con) : NULL;
+}
+
+static void ip_config_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	device_watch_st *w = (device_watch_st *)user_data;
+
+	event_post(w->sub, LIBNM_WRAPPER_EVENT_IP_CONFIG, nm_device_get_iface(w->dev), NULL, 0, 0);
+}
+
+static void ip_config_watch(device_watch_st *w, NMIPConfig **slot, NMIPConfig *config)
+{
+	if (*slot)
+	{
+		g_signal_handlers_disconnect_by_data(*slot, w);
+		g_object_unref(*slot);
+	}
+
+	*slot = config ? g_object_ref(config) : NULL;
+	if (*slot)
+		g_signal_connect(*slot, "notify", G_CALLBACK(ip_config_changed), w);
+}
+
+static void device_ip_config_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	device_watch_st *w = (device_watch_st *)user_data;
+
+	ip_config_watch(w, &w->ip4, nm_device_get_ip4_config(w->dev));
+	ip_config_watch(w, &w->ip6, nm_device_get_ip6_config(w->dev));
+	event_post(w->sub, LIBNM_WRAPPER_EVENT_IP_CONFIG, nm_device_get_iface(w->dev), NULL, 0, 0);
+}
+
+static void device_state_changed(NMDevice *dev, guint new_state, guint old_state,
+	guint reason, gpointer user_data)
+{
+	device_watch_st *w = (device_watch_st *)user_data;
+
+	event_post(w->sub, LIBNM_WRAPPER_EVENT_DEVICE_STATE, nm_device_get_iface(dev), NULL, new_state, reason);
+}
+
+static void device_ap_list_changed(NMDeviceWifi *dev, GObject *ap, gpointer user_data)
+{
+	device_watch_st *w = (device_watch_st *)user_data;
+
+	event_post(w->sub, LIBNM_WRAPPER_EVENT_AP_LIST, nm_device_get_iface(NM_DEVICE(dev)), NULL, 0, 0);
+}
+
+static void device_watch_free(gpointer data)
+{
+	device_watch_st *w = (device_watch_st *)data;
+
+	ip_config_watch(w, &w->ip4, NULL);
+	ip_config_watch(w, &w->ip6, NULL);
+	g_signal_handlers_disconnect_by_data(w->dev, w);
+	g_object_unref(w->dev);
+	g_free(w);
+}
+
+static void device_watch(libnm_wrapper_subscription_st *sub, NMDevice *dev)
+{
+	device_watch_st *w;
+
+	if (g_hash_table_contains(sub->devices, dev))
+		return;
+
+	w = g_malloc0(sizeof(device_watch_st));
+	w->sub = sub;
+	w->dev = g_object_ref(dev);
+
+	g_signal_connect(dev, "state-changed", G_CALLBACK(device_state_changed), w);
+	g_signal_connect(dev, "notify::" NM_DEVICE_IP4_CONFIG, G_CALLBACK(device_ip_config_changed), w);
+	g_signal_connect(dev, "notify::" NM_DEVICE_IP6_CONFIG, G_CALLBACK(device_ip_config_changed), w);
+	if (NM_IS_DEVICE_WIFI(dev))
+	{
+		g_signal_connect(dev, "access-point-added", G_CALLBACK(device_ap_list_changed), w);
+		g_signal_connect(dev, "access-point-removed", G_CALLBACK(device_ap_list_changed), w);
+	}
+
+	ip_config_watch(w, &w->ip4, nm_device_get_ip4_config(dev));
+	ip_config_watch(w, &w->ip6, nm_device_get_ip6_config(dev));
+
+	g_hash_table_insert(sub->devices, dev, w);
+}
+
+static void active_state_changed(NMActiveConnection *active, guint state, guint reason, gpointer user_data)
+{
+	active_watch_st *w = (active_watch_st *)user_data;
+
+	event_post(w->sub, LIBNM_WRAPPER_EVENT_ACTIVE_STATE,
+		active_connection_interface(active), nm_active_connection_get_id(active), state, reason);
+}
+
+static void active_watch_free(gpointer data)
+{
+	active_watch_st *w = (active_watch_st *)data;
+
+	g_signal_handlers_disconnect_by_data(w->active, w);
+	g_object_unref(w->active);
+	g_free(w);
+}
+
+static void active_watch(libnm_wrapper_subscription_st *sub, NMActiveConnection *active)
+{
+	active_watch_st *w;
+
+	if (g_hash_table_contains(sub->actives, active))
+		return;
+
+	w = g_malloc0(sizeof(active_watch_st));
+	w->sub = sub;
+	w->active = g_object_ref(active);
+	g_signal_connect(active, "state-changed", G_CALLBACK(active_state_changed), w);
+	g_hash_table_insert(sub->actives, active, w);
+}
+
+static void client_device_added(NMClient *client, NMDevice *dev, gpointer user_data)
+{
+	libnm_wrapper_subscription_st *sub = (libnm_wrapper_subscription_st *)user_data;
+
+	device_watch(sub, dev);
+	event_post(sub, LIBNM_WRAPPER_EVENT_DEVICE_ADDED, nm_device_get_iface(dev), NULL,
+		nm_device_get_state(dev), nm_device_get_state_reason(dev));
+}
+
+static void client_device_removed(NMClient *client, NMDevice *dev, gpointer user_data)
+{
+	libnm_wrapper_subscription_st *sub = (libnm_wrapper_subscription_st *)user_data;
+
+	g_hash_table_remove(sub->devices, dev);
+	event_post(sub, LIBNM_WRAPPER_EVENT_DEVICE_REMOVED, nm_device_get_iface(dev), NULL, 0, 0);
+}
+
+static void client_active_added(NMClient *client, NMActiveConnection *active, gpointer user_data)
+{
+	libnm_wrapper_subscription_st *sub = (libnm_wrapper_subscription_st *)user_data;
+
+	active_watch(sub, active);
+	event_post(sub, LIBNM_WRAPPER_EVENT_ACTIVE_STATE, active_connection_interface(active),
+		nm_active_connection_get_id(active), nm_active_connection_get_state(active),
+		nm_active_connection_get_state_reason(active));
+}
+
+static void client_active_removed(NMClient *client, NMActiveConnection *active, gpointer user_data)
+{
+	libnm_wrapper_subscription_st *sub = (libnm_wrapper_subscription_st *)user_data;
+
+	g_hash_table_remove(sub->actives, active);
+	event_post(sub, LIBNM_WRAPPER_EVENT_ACTIVE_STATE, active_connection_interface(active),
+		nm_active_connection_get_id(active), NM_ACTIVE_CONNECTION_STATE_DEACTIVATED,
+		nm_active_connection_get_state_reason(active));
+}
+
+static void client_connection_added(NMClient *client, NMRemoteConnection *remote, gpointer user_data)
+{
+	event_post((libnm_wrapper_subscription_st *)user_data, LIBNM_WRAPPER_EVENT_CONNECTION_ADDED,
+		connection_interface(remote), nm_connection_get_id(NM_CONNECTION(remote)), 0, 0);
+}
+
+static void client_connection_removed(NMClient *client, NMRemoteConnection *remote, gpointer user_data)
+{
+	event_post((libnm_wrapper_subscription_st *)user_data, LIBNM_WRAPPER_EVENT_CONNECTION_REMOVED,
+		connection_interface(remote), nm_connection_get_id(NM_CONNECTION(remote)), 0, 0);
+}
+
+/* Stop collecting events, queued events can still be read */
+static void subscription_detach(libnm_wrapper_subscription_st *sub)
+{
+	if (!sub->st)
+		return;
+
+	g_signal_handlers_disconnect_by_data(sub->st->client, sub);
+	g_hash_table_unref(sub->devices);
+	g_hash_table_unref(sub->actives);
+
+	if (sub->timer)
+	{
+		g_source_destroy(sub->timer);
+		g_source_unref(sub->timer);
+		sub->timer = NULL;
+	}
+
+	sub->st->subscriptions = g_slist_remove(sub->st->subscriptions, sub);
+	sub->st = NULL;
+}
+
+/**
+ * Detach the subscriptions of a handle being destroyed. They stop delivering
+ * events but stay valid until cancelled.
+ */
+void nm_wrapper_event_detach_all(libnm_wrapper_handle_st *st)
+{
+	while (st->subscriptions)
+		subscription_detach(st->subscriptions->data);
+}
+
+/**
+ * @name Event Subscription API
+ */
+/**@{*/
+/**
+ * Subscribe to changes of devices and connections.
+ * @param hd: library handle
+ * @param mask: LIBNM_WRAPPER_EVENT_* to deliver
+ * @param interface: only deliver events of this interface, NULL for all.
+ *                   Events without an interface, such as changes of profiles
+ *                   not bound to one, are not delivered when set
+ * @param coalesce_ms: merge changes within this period, 0 to deliver at once
+ * @param callback: called for every event, NULL to queue events
+ * @param user_data: user data passed to callback
+ *
+ * Returns: subscription, NULL if unsuccessful
+ */
+libnm_wrapper_subscription libnm_wrapper_event_subscribe(libnm_wrapper_handle hd, unsigned int mask,
+	const char *interface, unsigned int coalesce_ms, LIBNM_WRAPPER_EVENT_CALLBACK callback, void *user_data)
+{
+	const GPtrArray *array;
+	libnm_wrapper_subscription_st *sub;
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+	NMClient *client = st->client;
+
+	sub = g_malloc0(sizeof(libnm_wrapper_subscription_st));
+	sub->fd = -1;
+	if (!callback)
+	{
+		sub->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (sub->fd < 0)
+		{
+			g_free(sub);
+			return NULL;
+		}
+	}
+
+	sub->st = st;
+	sub->context = g_main_context_ref(handle_context(hd, NULL));
+	sub->mask = mask;
+	sub->interface = g_strdup(interface);
+	sub->coalesce_ms = coalesce_ms;
+	sub->callback = callback;
+	sub->user_data = user_data;
+	sub->pending = g_array_new(FALSE, FALSE, sizeof(NMWrapperEvent));
+	sub->ref = 1;
+	sub->devices = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, device_watch_free);
+	sub->actives = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, active_watch_free);
+
+	array = nm_client_get_devices(client);
+	for (int i = 0; array && i < array->len; i++)
+		device_watch(sub, g_ptr_array_index(array, i));
+
+	array = nm_client_get_active_connections(client);
+	for (int i = 0; array && i < array->len; i++)
+		active_watch(sub, g_ptr_array_index(array, i));
+
+	g_signal_connect(client, NM_CLIENT_DEVICE_ADDED, G_CALLBACK(client_device_added), sub);
+	g_signal_connect(client, NM_CLIENT_DEVICE_REMOVED, G_CALLBACK(client_device_removed), sub);
+	g_signal_connect(client, NM_CLIENT_ACTIVE_CONNECTION_ADDED, G_CALLBACK(client_active_added), sub);
+	g_signal_connect(client, NM_CLIENT_ACTIVE_CONNECTION_REMOVED, G_CALLBACK(client_active_removed), sub);
+	g_signal_connect(client, NM_CLIENT_CONNECTION_ADDED, G_CALLBACK(client_connection_added), sub);
+	g_signal_connect(client, NM_CLIENT_CONNECTION_REMOVED, G_CALLBACK(client_connection_removed), sub);
+
+	st->subscriptions = g_slist_prepend(st->subscriptions, sub);
+	return (libnm_wrapper_subscription) sub;
+}
+
+/**
+ * Get the file descriptor of a queued subscription.
+ * @param sub: subscription
+ *
+ * Returns: file descriptor, -1 if the subscription delivers through a callback
+ */
+int libnm_wrapper_event_get_fd(libnm_wrapper_subscription sub)
+{
+	nm_wrapper_assert(sub, -1)
+	return ((libnm_wrapper_subscription_st *)sub)->fd;
+}
+
+/**
+ * Read queued events.
+ * @param sub: subscription
+ * @param events: location to store events
+ * @param size: size of events
+ *
+ * Returns: number of events stored
+ */
+int libnm_wrapper_event_read(libnm_wrapper_subscription sub, NMWrapperEvent *events, int size)
+{
+	int num;
+	uint64_t value;
+	libnm_wrapper_subscription_st *st = (libnm_wrapper_subscription_st *)sub;
+
+	nm_wrapper_assert(st, 0)
+	if (st->callback || size <= 0)
+		return 0;
+
+	num = MIN(st->pending->len, size);
+	memcpy(events, st->pending->data, num * sizeof(NMWrapperEvent));
+	g_array_remove_range(st->pending, 0, num);
+
+	// Leave the fd readable while events are still queued
+	if (!st->pending->len)
+		(void)!read(st->fd, &value, sizeof(value));
+
+	return num;
+}
+
+/**
+ * Cancel a subscription, also after the handle it was created on is
+ * destroyed.
+ * @param sub: subscription
+ */
+void libnm_wrapper_event_unsubscribe(libnm_wrapper_subscription sub)
+{
+	libnm_wrapper_subscription_st *st = (libnm_wrapper_subscription_st *)sub;
+
+	if (!st)
+		return;
+
+	subscription_detach(st);
+	st->cancelled = true;
+	subscription_unref(st);
+}
+/**@}*/
@@ -18,13 +18,145 @@ static inline void ssid_gbytes_to_string(GBytes *src, char *dst, int len)
 	g_free(ptr);
 }
 
+static inline int hex_nibble(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/* Parse a "xx:xx:xx:xx:xx:xx" BSSID into its binary form */
+static inline bool bssid_parse(const char *str, unsigned char *mac)
+{
+	int hi, lo;
+
+	for (int i = 0; i < LIBNM_WRAPPER_MAX_MAC_ADDR_LEN; i++, str += 3)
+	{
+		hi = hex_nibble(str[0]);
+		lo = hi < 0 ? -1 : hex_nibble(str[1]);
+		if (lo < 0 || (i < LIBNM_WRAPPER_MAX_MAC_ADDR_LEN - 1 && str[2] != ':'))
+			return false;
+		mac[i] = (hi << 4) | lo;
+	}
+	return true;
+}
+
 #define nm_wrapper_assert(x, error) if(!x) return error;
 
+/* Make async operations dispatch their completion on the given context */
+static inline void context_push(GMainContext *context)
+{
+	if (context)
+		g_main_context_push_thread_default(context);
+}
+
+static inline void context_pop(GMainContext *context)
+{
+	if (context)
+		g_main_context_pop_thread_default(context);
+}
+
+typedef struct _nm_wrapper_cache_st nm_wrapper_cache_st;
+typedef struct _nm_wrapper_poll_st nm_wrapper_poll_st;
+typedef struct _nm_wrapper_wiphy_st nm_wrapper_wiphy_st;
+typedef struct _nm_wrapper_reg_st nm_wrapper_reg_st;
+
 typedef struct _libnm_wrapper_handle_st
 {
 	NMClient *client;
+	GMainContext *context;
+	nm_wrapper_cache_st *cache;
+	nm_wrapper_poll_st *poll;
+	nm_wrapper_wiphy_st *wiphy;
+	nm_wrapper_reg_st *reg;
+	// Event subscriptions, detached when the handle is destroyed
+	GSList *subscriptions;
 } libnm_wrapper_handle_st;
 
+/* Context an async operation runs on, the handle's one unless overridden */
+static inline GMainContext *handle_context(libnm_wrapper_handle hd, GMainContext *context)
+{
+	return context ? context : ((libnm_wrapper_handle_st *)hd)->context;
+}
+
+/**
+ * Blocking APIs are thin shims over the async ones: they run a private main
+ * loop on the same context until the completion callback fires.
+ */
+typedef struct _libnm_wrapper_sync_st
+{
+	GMainLoop *loop;
+	int result;
+	bool done;
+}libnm_wrapper_sync_st;
+
+static inline void sync_init(libnm_wrapper_sync_st *sync, GMainContext *context)
+{
+	sync->loop = g_main_loop_new(context, FALSE);
+	sync->result = LIBNM_WRAPPER_ERR_FAIL;
+	sync->done = false;
+}
+
+static inline void sync_done_cb(int result, void *user_data)
+{
+	libnm_wrapper_sync_st *sync = (libnm_wrapper_sync_st *)user_data;
+
+	sync->result = result;
+	sync->done = true;
+	g_main_loop_quit(sync->loop);
+}
+
+/**
+ * Wait for an async operation started with sync_done_cb.
+ * @param sync: sync state passed as user data of the async call
+ * @param ret: return value of the async call
+ *
+ * Returns: ret if the operation could not be started, otherwise its result
+ */
+static inline int sync_wait(libnm_wrapper_sync_st *sync, int ret)
+{
+	if (ret == LIBNM_WRAPPER_ERR_SUCCESS)
+	{
+		if (!sync->done)
+			g_main_loop_run(sync->loop);
+		ret = sync->result;
+	}
+	g_main_loop_unref(sync->loop);
+	return ret;
+}
+
+/* Device status of a resolved device, see libnm_wrapper_device.c */
+void nm_wrapper_get_device_status(NMDevice *dev, NMWrapperDevice *status);
+
+/* Connection lookup cache, see libnm_wrapper_cache.c */
+nm_wrapper_cache_st *nm_wrapper_cache_new(NMClient *client);
+void nm_wrapper_cache_free(nm_wrapper_cache_st *cache);
+NMRemoteConnection *nm_wrapper_cache_get_connection_by_id(libnm_wrapper_handle hd, const char *id);
+NMRemoteConnection *nm_wrapper_cache_get_connection_by_uuid(libnm_wrapper_handle hd, const char *uuid);
+const GPtrArray *nm_wrapper_cache_get_connections_by_interface(libnm_wrapper_handle hd, const char *interface);
+
+/* Event subscriptions, see libnm_wrapper_event.c */
+void nm_wrapper_event_detach_all(libnm_wrapper_handle_st *st);
+
+/* External poll integration, see libnm_wrapper_poll.c */
+void nm_wrapper_poll_free(nm_wrapper_poll_st *poll);
+
+/* Radio capabilities, see libnm_wrapper_wiphy.c */
+struct nl80211_wiphy_cache;
+struct nl80211_wiphy_caps;
+void nm_wrapper_wiphy_free(nm_wrapper_wiphy_st *wiphy);
+const struct nl80211_wiphy_cache *nm_wrapper_wiphy_sync(libnm_wrapper_handle hd);
+int nm_wrapper_wiphy_index(libnm_wrapper_handle hd, const char *interface);
+const struct nl80211_wiphy_caps *nm_wrapper_wiphy_lookup(libnm_wrapper_handle hd, const char *interface);
+
+/* Regulatory watcher, see libnm_wrapper_reg.c */
+void nm_wrapper_reg_free(nm_wrapper_reg_st *reg);
+char *nm_wrapper_reg_prune_frequency_list(libnm_wrapper_handle hd, const char *interface,
+	const char *frequency_list);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "libnm_wrapper_internal.h"
+
+/**
+ * External poll integration.
+ * The descriptors a GMainContext polls on are mirrored into an epoll set,
+ * and the context timeout into a timerfd of the same set. Each dispatch runs
+ * the check and dispatch steps of one context iteration, then the prepare and
+ * query steps of the next one to refresh the epoll set and the timer.
+ */
+
+typedef struct _poll_fd_st
+{
+	int fd;
+	uint32_t events;
+} poll_fd_st;
+
+struct _nm_wrapper_poll_st
+{
+	int epfd;
+	int tfd;
+	int max_priority;
+	// Descriptors returned by the last query
+	GPollFD *fds;
+	int nfds;
+	int allocated;
+	// Descriptors currently in the epoll set, timerfd excluded
+	GArray *registered;
+};
+
+static uint32_t poll_to_epoll(gushort events)
+{
+	uint32_t ev = 0;
+
+	if (events & G_IO_IN)
+		ev |= EPOLLIN;
+	if (events & G_IO_OUT)
+		ev |= EPOLLOUT;
+	if (events & G_IO_PRI)
+		ev |= EPOLLPRI;
+	return ev;
+}
+
+static void poll_arm_timer(nm_wrapper_poll_st *p, int timeout)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	if (timeout == 0)
+		// Already due, an all-zero value would disarm the timer instead
+		its.it_value.tv_nsec = 1;
+	else if (timeout > 0)
+	{
+		its.it_value.tv_sec = timeout / 1000;
+		its.it_value.tv_nsec = (timeout % 1000) * 1000000;
+	}
+
+	timerfd_settime(p->tfd, 0, &its, NULL);
+}
+
+static void poll_sync_fds(nm_wrapper_poll_st *p)
+{
+	struct epoll_event ev;
+	poll_fd_st *r;
+	GArray *wanted = g_array_new(FALSE, FALSE, sizeof(poll_fd_st));
+	int i, j;
+
+	// A descriptor may be queried more than once, merge their events
+	for (i = 0; i < p->nfds; i++)
+	{
+		for (j = 0; j < wanted->len; j++)
+		{
+			r = &g_array_index(wanted, poll_fd_st, j);
+			if (r->fd == p->fds[i].fd)
+			{
+				r->events |= poll_to_epoll(p->fds[i].events);
+				break;
+			}
+		}
+		if (j == wanted->len)
+		{
+			poll_fd_st n = { p->fds[i].fd, poll_to_epoll(p->fds[i].events) };
+			g_array_append_val(wanted, n);
+		}
+	}
+
+	for (i = 0; i < p->registered->len; i++)
+	{
+		r = &g_array_index(p->registered, poll_fd_st, i);
+		for (j = 0; j < wanted->len; j++)
+			if (g_array_index(wanted, poll_fd_st, j).fd == r->fd)
+				break;
+		if (j == wanted->len)
+			epoll_ctl(p->epfd, EPOLL_CTL_DEL, r->fd, NULL);
+	}
+
+	for (i = 0; i < wanted->len; i++)
+	{
+		r = &g_array_index(wanted, poll_fd_st, i);
+		memset(&ev, 0, sizeof(ev));
+		ev.events = r->events;
+		ev.data.fd = r->fd;
+		if (epoll_ctl(p->epfd, EPOLL_CTL_MOD, r->fd, &ev) < 0 && errno == ENOENT)
+			epoll_ctl(p->epfd, EPOLL_CTL_ADD, r->fd, &ev);
+	}
+
+	g_array_unref(p->registered);
+	p->registered = wanted;
+}
+
+/* Prepare and query the next iteration, context must be acquired */
+static void poll_prepare(nm_wrapper_poll_st *p, GMainContext *context)
+{
+	int timeout;
+
+	g_main_context_prepare(context, &p->max_priority);
+	while ((p->nfds = g_main_context_query(context, p->max_priority, &timeout,
+		p->fds, p->allocated)) > p->allocated)
+	{
+		p->allocated = p->nfds;
+		p->fds = g_renew(GPollFD, p->fds, p->allocated);
+	}
+
+	poll_sync_fds(p);
+	poll_arm_timer(p, timeout);
+}
+
+static nm_wrapper_poll_st *poll_new(void)
+{
+	struct epoll_event ev;
+	nm_wrapper_poll_st *p = g_malloc0(sizeof(nm_wrapper_poll_st));
+
+	p->epfd = epoll_create1(EPOLL_CLOEXEC);
+	p->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	p->registered = g_array_new(FALSE, FALSE, sizeof(poll_fd_st));
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = p->tfd;
+	if (p->epfd < 0 || p->tfd < 0 || epoll_ctl(p->epfd, EPOLL_CTL_ADD, p->tfd, &ev) < 0)
+	{
+		nm_wrapper_poll_free(p);
+		return NULL;
+	}
+
+	return p;
+}
+
+void nm_wrapper_poll_free(nm_wrapper_poll_st *p)
+{
+	if (!p)
+		return;
+
+	if (p->epfd >= 0)
+		close(p->epfd);
+	if (p->tfd >= 0)
+		close(p->tfd);
+	g_array_unref(p->registered);
+	g_free(p->fds);
+	g_free(p);
+}
+
+/**
+ * Get a file descriptor to poll the main context of the handle with.
+ * @param hd: library handle
+ *
+ * Returns: file descriptor, -1 if unsuccessful
+ */
+int libnm_wrapper_get_fd(libnm_wrapper_handle hd)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+
+	nm_wrapper_assert(st, -1)
+
+	if (!st->poll)
+	{
+		if (!g_main_context_acquire(st->context))
+			return -1;
+
+		st->poll = poll_new();
+		if (st->poll)
+			poll_prepare(st->poll, st->context);
+		g_main_context_release(st->context);
+
+		if (!st->poll)
+			return -1;
+	}
+
+	return st->poll->epfd;
+}
+
+/**
+ * Dispatch the pending events of the main context of the handle.
+ * @param hd: library handle
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_dispatch_pending(libnm_wrapper_handle hd)
+{
+	uint64_t expirations;
+	nm_wrapper_poll_st *p;
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+
+	nm_wrapper_assert(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	p = st->poll;
+	nm_wrapper_assert(p, LIBNM_WRAPPER_ERR_FAIL)
+
+	if (!g_main_context_acquire(st->context))
+		return LIBNM_WRAPPER_ERR_FAIL;
+
+	// Collect revents of the queried descriptors, never waits
+	if (p->nfds)
+		poll((struct pollfd *)p->fds, p->nfds, 0);
+	(void)!read(p->tfd, &expirations, sizeof(expirations));
+
+	if (g_main_context_check(st->context, p->max_priority, p->fds, p->nfds))
+		g_main_context_dispatch(st->context);
+
+	poll_prepare(p, st->context);
+	g_main_context_release(st->context);
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
@@ -0,0 +1,575 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib-unix.h>
+#include "nl80211.h"
+#include "nl80211_wiphy.h"
+#include "genl.h"
+#include "libnm_wrapper_internal.h"
+
+/**
+ * Regulatory watcher.
+ * The rules of the current regulatory domain are read with
+ * NL80211_CMD_GET_REG and read again whenever the nl80211 "regulatory"
+ * multicast group reports a change. Radios coming and going are reported by
+ * the "config" group, their capabilities come from the radio capability
+ * table of libnm_wrapper_wiphy.c. On every change the frequency_list of each
+ * wifi profile is pruned to the channels the rules allow and the radio can
+ * use, and the result is kept per profile until the next change.
+ */
+
+// Width of the channels a frequency_list refers to, in kHz
+#define REG_CHANNEL_WIDTH_KHZ	20000
+// Delay before reading the rules again after a failed read
+#define REG_RETRY_MS	2000
+
+typedef struct _pruned_entry_st
+{
+	// frequency_list and interface of the profile the entry was computed from
+	char *source;
+	char *iface;
+	char *pruned;
+} pruned_entry_st;
+
+struct _nm_wrapper_reg_st
+{
+	libnm_wrapper_handle_st *st;
+	// Requests are blocking, events are read without blocking
+	struct nl80211_state req;
+	struct nl80211_state ev;
+	struct nl_cb *ev_cb;
+	GSource *source;
+	// Pending retry of a failed read, no notification may come to trigger one
+	GSource *retry;
+	bool changed;
+	NMWrapperRegulatory reg;
+	// Profile id -> pruned_entry_st
+	GHashTable *pruned;
+	LIBNM_WRAPPER_REGULATORY_CALLBACK callback;
+	void *user_data;
+};
+
+static void pruned_entry_free(gpointer data)
+{
+	pruned_entry_st *e = data;
+
+	g_free(e->source);
+	g_free(e->iface);
+	g_free(e->pruned);
+	g_free(e);
+}
+
+static bool freq_allowed(const NMWrapperRegulatory *reg, unsigned long freq)
+{
+	unsigned long khz = freq * 1000;
+
+	for (int i = 0; i < reg->num_rules; i++)
+	{
+		if (reg->rules[i].start_freq + REG_CHANNEL_WIDTH_KHZ / 2 <= khz &&
+		    khz + REG_CHANNEL_WIDTH_KHZ / 2 <= reg->rules[i].end_freq)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Whether the radio caps, or any radio of cache when caps is NULL, can use
+ * freq. Without any radio known only the rules apply.
+ */
+static bool freq_supported(const struct nl80211_wiphy_cache *cache,
+	const struct nl80211_wiphy_caps *caps, unsigned long freq)
+{
+	if (caps)
+		return nl80211_wiphy_freq_usable(caps, freq);
+
+	if (!cache || !cache->n_wiphys)
+		return true;
+
+	for (int i = 0; i < cache->n_wiphys; i++)
+	{
+		if (nl80211_wiphy_freq_usable(&cache->wiphys[i], freq))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Keep the frequencies of list that the rules allow and the radio caps, any
+ * radio of cache when caps is NULL, can use.
+ * Returns: pruned list, frequencies separated by spaces, NULL if list is
+ *          malformed. Free with g_free().
+ */
+static char *prune_frequency_list(const NMWrapperRegulatory *reg,
+	const struct nl80211_wiphy_cache *cache, const struct nl80211_wiphy_caps *caps,
+	const char *list)
+{
+	GString *pruned = g_string_new(NULL);
+	unsigned long freq;
+	char *end;
+
+	while (list && *list)
+	{
+		if (*list == ' ' || *list == ',')
+		{
+			list++;
+			continue;
+		}
+
+		freq = strtoul(list, &end, 10);
+		if (end == list || !freq || freq > G_MAXUINT32)
+		{
+			g_string_free(pruned, TRUE);
+			return NULL;
+		}
+		list = end;
+
+		if (!freq_allowed(reg, freq) || !freq_supported(cache, caps, freq))
+			continue;
+
+		if (pruned->len)
+			g_string_append_c(pruned, ' ');
+		g_string_append_printf(pruned, "%lu", freq);
+	}
+
+	return g_string_free(pruned, FALSE);
+}
+
+/**
+ * Radio of an interface. Resolving it costs a request, so when radios is
+ * given, an interface name -> radio index table, each interface is only
+ * resolved once.
+ */
+static const struct nl80211_wiphy_caps *reg_iface_caps(nm_wrapper_reg_st *r,
+	const struct nl80211_wiphy_cache *cache, GHashTable *radios, const char *iface)
+{
+	gpointer value;
+	int index;
+
+	if (!cache || !iface)
+		return NULL;
+
+	if (radios && g_hash_table_lookup_extended(radios, iface, NULL, &value))
+		index = GPOINTER_TO_INT(value);
+	else
+	{
+		index = nm_wrapper_wiphy_index(r->st, iface);
+		if (radios)
+			g_hash_table_insert(radios, g_strdup(iface), GINT_TO_POINTER(index));
+	}
+
+	return index < 0 ? NULL : nl80211_wiphy_cache_get(cache, index);
+}
+
+static const pruned_entry_st *reg_prune_connection(nm_wrapper_reg_st *r, NMConnection *connection,
+	GHashTable *radios)
+{
+	NMSettingWireless *s_wifi = nm_connection_get_setting_wireless(connection);
+	NMSettingConnection *s_con = nm_connection_get_setting_connection(connection);
+	const char *id = nm_connection_get_id(connection);
+	const struct nl80211_wiphy_cache *cache;
+	const char *source, *iface;
+	pruned_entry_st *e;
+
+	if (!s_wifi || !id)
+		return NULL;
+
+	source = nm_setting_wireless_get_frequency_list(s_wifi);
+	if (!source)
+		source = "";
+	iface = s_con ? nm_setting_connection_get_interface_name(s_con) : NULL;
+
+	e = g_hash_table_lookup(r->pruned, id);
+	if (e && !strcmp(e->source, source) && !g_strcmp0(e->iface, iface))
+		return e;
+
+	cache = nm_wrapper_wiphy_sync(r->st);
+	e = g_malloc0(sizeof(pruned_entry_st));
+	e->source = g_strdup(source);
+	e->iface = g_strdup(iface);
+	e->pruned = prune_frequency_list(&r->reg, cache, reg_iface_caps(r, cache, radios, iface), source);
+	if (!e->pruned)
+		e->pruned = g_strdup("");
+	g_hash_table_replace(r->pruned, g_strdup(id), e);
+
+	return e;
+}
+
+static void reg_prune_all(nm_wrapper_reg_st *r)
+{
+	const GPtrArray *connections = nm_client_get_connections(r->st->client);
+	// Radio of each interface profiles are bound to, for this refresh
+	GHashTable *radios = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	g_hash_table_remove_all(r->pruned);
+	for (int i = 0; connections && i < connections->len; i++)
+		reg_prune_connection(r, NM_CONNECTION(g_ptr_array_index(connections, i)), radios);
+	g_hash_table_unref(radios);
+}
+
+static int reg_handler(struct nl_msg *msg, void *arg)
+{
+	NMWrapperRegulatory *reg = arg;
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct nlattr *rule_tb[NL80211_REG_RULE_ATTR_MAX + 1];
+	struct nlattr *rule;
+	NMWrapperRegRule *r;
+	int rem;
+
+	nl80211_parse(msg, tb);
+
+	if (!tb[NL80211_ATTR_REG_ALPHA2] || !tb[NL80211_ATTR_REG_RULES])
+		return NL_SKIP;
+
+	memset(reg, 0, sizeof(*reg));
+	nla_strlcpy(reg->alpha2, tb[NL80211_ATTR_REG_ALPHA2], sizeof(reg->alpha2));
+	if (tb[NL80211_ATTR_DFS_REGION])
+		reg->dfs_region = nla_get_u8(tb[NL80211_ATTR_DFS_REGION]);
+
+	nla_for_each_nested(rule, tb[NL80211_ATTR_REG_RULES], rem)
+	{
+		if (reg->num_rules == LIBNM_WRAPPER_MAX_REG_RULES)
+			break;
+		if (nla_parse_nested(rule_tb, NL80211_REG_RULE_ATTR_MAX, rule, NULL))
+			continue;
+		if (!rule_tb[NL80211_ATTR_FREQ_RANGE_START] || !rule_tb[NL80211_ATTR_FREQ_RANGE_END])
+			continue;
+
+		r = &reg->rules[reg->num_rules++];
+		r->start_freq = nla_get_u32(rule_tb[NL80211_ATTR_FREQ_RANGE_START]);
+		r->end_freq = nla_get_u32(rule_tb[NL80211_ATTR_FREQ_RANGE_END]);
+		if (rule_tb[NL80211_ATTR_FREQ_RANGE_MAX_BW])
+			r->max_bandwidth = nla_get_u32(rule_tb[NL80211_ATTR_FREQ_RANGE_MAX_BW]);
+		if (rule_tb[NL80211_ATTR_POWER_RULE_MAX_EIRP])
+			r->max_eirp = nla_get_u32(rule_tb[NL80211_ATTR_POWER_RULE_MAX_EIRP]);
+		if (rule_tb[NL80211_ATTR_REG_RULE_FLAGS])
+			r->flags = nla_get_u32(rule_tb[NL80211_ATTR_REG_RULE_FLAGS]);
+	}
+
+	return NL_SKIP;
+}
+
+/* Read the rules of the current regulatory domain */
+static int reg_fetch(nm_wrapper_reg_st *r)
+{
+	NMWrapperRegulatory reg;
+	struct nl_msg *msg;
+
+	msg = nl80211_msg_alloc(&r->req, NL80211_CMD_GET_REG, 0);
+	if (!msg)
+		return LIBNM_WRAPPER_ERR_INSUFFICIENT_MEMORY;
+
+	// Waits for the acknowledgement as well, so the next request starts
+	// from an empty socket
+	memset(&reg, 0, sizeof(reg));
+	if (nl80211_send_and_recv(&r->req, msg, reg_handler, &reg) || !reg.alpha2[0])
+		return LIBNM_WRAPPER_ERR_FAIL;
+
+	r->reg = reg;
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+static int reg_event_handler(struct nl_msg *msg, void *arg)
+{
+	nm_wrapper_reg_st *r = arg;
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+
+	switch (gnlh->cmd)
+	{
+		case NL80211_CMD_REG_CHANGE:
+		case NL80211_CMD_WIPHY_REG_CHANGE:
+		case NL80211_CMD_NEW_WIPHY:
+		case NL80211_CMD_DEL_WIPHY:
+			r->changed = true;
+			break;
+		default:
+			break;
+	}
+	return NL_SKIP;
+}
+
+static gboolean reg_retry(gpointer user_data);
+
+/* Read the rules again after a change, retrying later if that fails */
+static void reg_refresh(nm_wrapper_reg_st *r)
+{
+	if (reg_fetch(r) != LIBNM_WRAPPER_ERR_SUCCESS)
+	{
+		if (!r->retry)
+		{
+			r->retry = g_timeout_source_new(REG_RETRY_MS);
+			g_source_set_callback(r->retry, reg_retry, r, NULL);
+			g_source_attach(r->retry, r->st->context);
+		}
+		return;
+	}
+
+	if (r->retry)
+	{
+		g_source_destroy(r->retry);
+		g_source_unref(r->retry);
+		r->retry = NULL;
+	}
+
+	r->changed = false;
+	reg_prune_all(r);
+	if (r->callback)
+		r->callback(&r->reg, r->user_data);
+}
+
+static gboolean reg_retry(gpointer user_data)
+{
+	nm_wrapper_reg_st *r = user_data;
+
+	g_source_unref(r->retry);
+	r->retry = NULL;
+	reg_refresh(r);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean reg_readable(gint fd, GIOCondition condition, gpointer user_data)
+{
+	nm_wrapper_reg_st *r = user_data;
+
+	// Notifications were lost, the domain or the radios may have changed
+	if (nl80211_event_drain(&r->ev, r->ev_cb) > 0)
+		r->changed = true;
+
+	if (r->changed)
+		reg_refresh(r);
+
+	return G_SOURCE_CONTINUE;
+}
+
+void nm_wrapper_reg_free(nm_wrapper_reg_st *r)
+{
+	if (!r)
+		return;
+
+	if (r->source)
+	{
+		g_source_destroy(r->source);
+		g_source_unref(r->source);
+	}
+	if (r->retry)
+	{
+		g_source_destroy(r->retry);
+		g_source_unref(r->retry);
+	}
+	if (r->ev_cb)
+		nl_cb_put(r->ev_cb);
+	nl80211_cleanup(&r->ev);
+	nl80211_cleanup(&r->req);
+	if (r->pruned)
+		g_hash_table_unref(r->pruned);
+	g_free(r);
+}
+
+static nm_wrapper_reg_st *reg_new(libnm_wrapper_handle_st *st)
+{
+	nm_wrapper_reg_st *r = g_malloc0(sizeof(nm_wrapper_reg_st));
+	int reg_mcid, config_mcid;
+
+	r->st = st;
+	r->pruned = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, pruned_entry_free);
+	if (nl80211_init(&r->req) || nl80211_init(&r->ev))
+		goto fail;
+
+	reg_mcid = nl_get_multicast_id(r->ev.nl_sock, "nl80211", "regulatory");
+	config_mcid = nl_get_multicast_id(r->ev.nl_sock, "nl80211", "config");
+	if (reg_mcid < 0 || config_mcid < 0)
+		goto fail;
+
+	// Subscribe before reading the rules so no change is missed
+	if (nl_socket_add_membership(r->ev.nl_sock, reg_mcid) ||
+	    nl_socket_add_membership(r->ev.nl_sock, config_mcid))
+		goto fail;
+	r->ev_cb = nl80211_event_cb_alloc(&r->ev, reg_event_handler, r);
+	if (!r->ev_cb)
+		goto fail;
+
+	if (reg_fetch(r) != LIBNM_WRAPPER_ERR_SUCCESS)
+		goto fail;
+
+	r->source = g_unix_fd_source_new(nl_socket_get_fd(r->ev.nl_sock), G_IO_IN);
+	g_source_set_callback(r->source, (GSourceFunc)reg_readable, r, NULL);
+	g_source_attach(r->source, st->context);
+
+	return r;
+
+fail:
+	nm_wrapper_reg_free(r);
+	return NULL;
+}
+
+/**
+ * Prune a frequency list for the radio of interface, any radio when interface
+ * is NULL, if the regulatory domain is followed.
+ * Returns: pruned list, a copy of frequency_list if the domain is not
+ *          followed, NULL if frequency_list is malformed. Free with g_free().
+ */
+char *nm_wrapper_reg_prune_frequency_list(libnm_wrapper_handle hd, const char *interface,
+	const char *frequency_list)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+	const struct nl80211_wiphy_cache *cache;
+
+	if (!st->reg)
+		return g_strdup(frequency_list ? frequency_list : "");
+
+	cache = nm_wrapper_wiphy_sync(hd);
+	return prune_frequency_list(&st->reg->reg, cache,
+		reg_iface_caps(st->reg, cache, NULL, interface), frequency_list);
+}
+
+/**
+ * @name Regulatory API
+ */
+/**@{*/
+/**
+ * Start following the regulatory domain.
+ * @param hd: library handle
+ * @param callback: called on the handle's context after every change of the
+ *                  domain or of the radios, with the pruned frequency lists
+ *                  already recomputed, may be NULL
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_watch(libnm_wrapper_handle hd,
+	LIBNM_WRAPPER_REGULATORY_CALLBACK callback, void *user_data)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+
+	nm_wrapper_assert(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+
+	if (!st->reg)
+	{
+		st->reg = reg_new(st);
+		if (!st->reg)
+			return LIBNM_WRAPPER_ERR_FAIL;
+		reg_prune_all(st->reg);
+	}
+
+	st->reg->callback = callback;
+	st->reg->user_data = user_data;
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Stop following the regulatory domain.
+ * @param hd: library handle
+ */
+void libnm_wrapper_regulatory_unwatch(libnm_wrapper_handle hd)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+
+	if (!st)
+		return;
+
+	nm_wrapper_reg_free(st->reg);
+	st->reg = NULL;
+}
+
+/**
+ * Get the cached rules of the current regulatory domain.
+ * @param hd: library handle
+ * @param reg: location to store the rules
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful, LIBNM_WRAPPER_ERR_FAIL if
+ *          the domain is not followed
+ */
+int libnm_wrapper_regulatory_get(libnm_wrapper_handle hd, NMWrapperRegulatory *reg)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+
+	nm_wrapper_assert(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(reg, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(st->reg, LIBNM_WRAPPER_ERR_FAIL)
+
+	*reg = st->reg->reg;
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Get the frequency_list of a wifi profile pruned to the channels of the
+ * current regulatory domain that its radio can use, any radio when the
+ * profile is not bound to an interface.
+ * @param hd: library handle
+ * @param id: connection profile id
+ * @param frequency_list: location to store the pruned list, empty if the
+ *                        profile has no frequency_list
+ * @param size: size of frequency_list
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_get_frequency_list(libnm_wrapper_handle hd, const char *id,
+	char *frequency_list, int size)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+	NMRemoteConnection *connection;
+	const pruned_entry_st *e;
+
+	nm_wrapper_assert(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(id, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(frequency_list, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(st->reg, LIBNM_WRAPPER_ERR_FAIL)
+
+	connection = nm_wrapper_cache_get_connection_by_id(hd, id);
+	if (!connection)
+		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+
+	// Computed again only if the profile changed since the last domain change
+	e = reg_prune_connection(st->reg, NM_CONNECTION(connection), NULL);
+	if (!e)
+		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+
+	safe_strncpy(frequency_list, e->pruned, size);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Prune a frequency list to the channels of the current regulatory domain
+ * that any radio can use.
+ * @param hd: library handle
+ * @param frequency_list: frequencies in MHz, same format as
+ *                        NMWrapperWirelessSettings.frequency_list
+ * @param pruned: location to store the allowed frequencies
+ * @param size: size of pruned
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_regulatory_prune_frequency_list(libnm_wrapper_handle hd,
+	const char *frequency_list, char *pruned, int size)
+{
+	libnm_wrapper_handle_st *st = (libnm_wrapper_handle_st *)hd;
+	char *list;
+
+	nm_wrapper_assert(st, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(pruned, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(st->reg, LIBNM_WRAPPER_ERR_FAIL)
+
+	list = nm_wrapper_reg_prune_frequency_list(hd, NULL, frequency_list);
+	if (!list)
+		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+
+	safe_strncpy(pruned, list, size);
+	g_free(list);
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+/**@}*/
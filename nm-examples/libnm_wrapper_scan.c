@@ -0,0 +1,489 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libnm_wrapper_internal.h"
+
+/**
+ * Scan list delta tracking.
+ * Every AP of the device has an entry stamped with the generation of its
+ * last change. Entries are kept in a queue ordered by that generation, so the
+ * changes since any generation are found by walking back from the tail.
+ * Removed APs stay as tombstones until there are too many of them.
+ */
+#define SCAN_DELTA_MAX_TOMBSTONES	256
+
+typedef struct _scan_entry_st
+{
+	// Link in the change queue, data points back to the entry
+	GList link;
+	NMAccessPoint *ap;
+	gulong strength_id;
+	guint64 added_gen;
+	guint64 changed_gen;
+	bool removed;
+	NMWrapperAccessPointDelta info;
+} scan_entry_st;
+
+typedef struct _libnm_wrapper_scan_delta_st
+{
+	NMDeviceWifi *dev;
+	guint64 generation;
+	// Changes at or before this generation may have been dropped
+	guint64 floor;
+	// NMAccessPoint -> scan_entry_st, live entries only
+	GHashTable *aps;
+	GQueue changes;
+	int tombstones;
+} libnm_wrapper_scan_delta_st;
+
+static void scan_entry_touch(libnm_wrapper_scan_delta_st *d, scan_entry_st *e)
+{
+	e->changed_gen = ++d->generation;
+	g_queue_unlink(&d->changes, &e->link);
+	g_queue_push_tail_link(&d->changes, &e->link);
+}
+
+static void scan_entry_free(scan_entry_st *e)
+{
+	if (e->ap)
+	{
+		g_signal_handler_disconnect(e->ap, e->strength_id);
+		g_object_unref(e->ap);
+	}
+	g_free(e);
+}
+
+static void scan_prune_tombstones(libnm_wrapper_scan_delta_st *d)
+{
+	GList *l, *next;
+	scan_entry_st *e;
+
+	if (d->tombstones <= SCAN_DELTA_MAX_TOMBSTONES)
+		return;
+
+	// Oldest first, stop once half of them are gone
+	for (l = d->changes.head; l && d->tombstones > SCAN_DELTA_MAX_TOMBSTONES / 2; l = next)
+	{
+		next = l->next;
+		e = (scan_entry_st *)l->data;
+		if (!e->removed)
+			continue;
+
+		d->floor = MAX(d->floor, e->changed_gen);
+		g_queue_unlink(&d->changes, &e->link);
+		scan_entry_free(e);
+		d->tombstones--;
+	}
+}
+
+static void ap_strength_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	libnm_wrapper_scan_delta_st *d = (libnm_wrapper_scan_delta_st *)user_data;
+	scan_entry_st *e = g_hash_table_lookup(d->aps, object);
+
+	if (!e)
+		return;
+
+	e->info.strength = nm_access_point_get_strength(e->ap);
+	e->info.frequency = nm_access_point_get_frequency(e->ap);
+	scan_entry_touch(d, e);
+}
+
+static void scan_entry_add(libnm_wrapper_scan_delta_st *d, NMAccessPoint *ap)
+{
+	GBytes *ssid;
+	const char *bssid;
+	scan_entry_st *e;
+
+	if (g_hash_table_contains(d->aps, ap))
+		return;
+
+	e = g_malloc0(sizeof(scan_entry_st));
+	e->link.data = e;
+	e->ap = g_object_ref(ap);
+	e->strength_id = g_signal_connect(ap, "notify::" NM_ACCESS_POINT_STRENGTH,
+		G_CALLBACK(ap_strength_changed), d);
+
+	ssid = nm_access_point_get_ssid(ap);
+	if (ssid)
+	{
+		e->info.ssid_len = MIN(g_bytes_get_size(ssid), LIBNM_WRAPPER_MAX_SSID_LEN);
+		memcpy(e->info.ssid, g_bytes_get_data(ssid, NULL), e->info.ssid_len);
+	}
+
+	bssid = nm_access_point_get_bssid(ap);
+	if (bssid)
+		bssid_parse(bssid, e->info.bssid);
+
+	e->info.frequency = nm_access_point_get_frequency(ap);
+	e->info.strength = nm_access_point_get_strength(ap);
+
+	g_hash_table_insert(d->aps, ap, e);
+	e->added_gen = e->changed_gen = ++d->generation;
+	g_queue_push_tail_link(&d->changes, &e->link);
+}
+
+static void ap_added(NMDeviceWifi *dev, GObject *ap, gpointer user_data)
+{
+	scan_entry_add((libnm_wrapper_scan_delta_st *)user_data, NM_ACCESS_POINT(ap));
+}
+
+static void ap_removed(NMDeviceWifi *dev, GObject *ap, gpointer user_data)
+{
+	libnm_wrapper_scan_delta_st *d = (libnm_wrapper_scan_delta_st *)user_data;
+	scan_entry_st *e = g_hash_table_lookup(d->aps, ap);
+
+	if (!e)
+		return;
+
+	g_hash_table_remove(d->aps, ap);
+	g_signal_handler_disconnect(e->ap, e->strength_id);
+	g_clear_object(&e->ap);
+	e->removed = true;
+	d->tombstones++;
+	scan_entry_touch(d, e);
+	scan_prune_tombstones(d);
+}
+
+/**
+ * Triggered scans complete when the device reports a new "last-scan"
+ * timestamp, or fail when the request is rejected or the deadline expires.
+ */
+#define SCAN_TIMEOUT_MS	15000
+
+typedef struct _scan_request_st
+{
+	NMDeviceWifi *dev;
+	gint64 last_scan;
+	gulong handler;
+	GSource *deadline;
+	GMainContext *context;
+	int result;
+	bool done;
+	// Held by the request callback and by the completion
+	int ref;
+	LIBNM_WRAPPER_ASYNC_CALLBACK callback;
+	void *user_data;
+} scan_request_st;
+
+static void scan_request_unref(scan_request_st *r)
+{
+	if (--r->ref)
+		return;
+
+	g_object_unref(r->dev);
+	g_main_context_unref(r->context);
+	g_free(r);
+}
+
+static gboolean scan_request_complete(gpointer user_data)
+{
+	scan_request_st *r = (scan_request_st *)user_data;
+
+	if (r->callback)
+		r->callback(r->result, r->user_data);
+	scan_request_unref(r);
+	return G_SOURCE_REMOVE;
+}
+
+static void scan_request_finish(scan_request_st *r, int result)
+{
+	if (r->done)
+		return;
+
+	r->done = true;
+	r->result = result;
+	g_signal_handler_disconnect(r->dev, r->handler);
+	g_source_destroy(r->deadline);
+	g_source_unref(r->deadline);
+	g_main_context_invoke(r->context, scan_request_complete, r);
+}
+
+static void scan_last_scan_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	scan_request_st *r = (scan_request_st *)user_data;
+
+	if (nm_device_wifi_get_last_scan(r->dev) != r->last_scan)
+		scan_request_finish(r, LIBNM_WRAPPER_ERR_SUCCESS);
+}
+
+static gboolean scan_deadline(gpointer user_data)
+{
+	scan_request_finish((scan_request_st *)user_data, LIBNM_WRAPPER_ERR_FAIL);
+	return G_SOURCE_REMOVE;
+}
+
+static void scan_requested_cb(GObject *object, GAsyncResult *result, gpointer user_data)
+{
+	GError *error = NULL;
+	scan_request_st *r = (scan_request_st *)user_data;
+
+	if (!nm_device_wifi_request_scan_finish(NM_DEVICE_WIFI(object), result, &error))
+	{
+		g_error_free(error);
+		scan_request_finish(r, LIBNM_WRAPPER_ERR_FAIL);
+	}
+	scan_request_unref(r);
+}
+
+/* Parse a frequency_list, frequencies in MHz separated by spaces or commas */
+static bool parse_frequency_list(const char *list, GVariantBuilder *builder, int *num)
+{
+	char *end;
+	unsigned long freq;
+
+	*num = 0;
+	while (list && *list)
+	{
+		if (*list == ' ' || *list == ',')
+		{
+			list++;
+			continue;
+		}
+
+		freq = strtoul(list, &end, 10);
+		if (end == list || !freq || freq > G_MAXUINT32)
+			return false;
+
+		g_variant_builder_add(builder, "u", (guint32) freq);
+		(*num)++;
+		list = end;
+	}
+	return true;
+}
+
+/**
+ * @name AP Management API
+ */
+/**@{*/
+/**
+ * Start tracking changes of the AP list of a wifi device.
+ * @param hd: library handle
+ * @param interface: on which interface
+ *
+ * Returns: delta tracker, NULL if unsuccessful
+ */
+libnm_wrapper_scan_delta libnm_wrapper_scan_delta_new(libnm_wrapper_handle hd, const char *interface)
+{
+	const GPtrArray *aps;
+	libnm_wrapper_scan_delta_st *d;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
+
+	if (!dev || !NM_IS_DEVICE_WIFI(dev))
+		return NULL;
+
+	d = g_malloc0(sizeof(libnm_wrapper_scan_delta_st));
+	d->dev = g_object_ref(NM_DEVICE_WIFI(dev));
+	d->aps = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_queue_init(&d->changes);
+
+	aps = nm_device_wifi_get_access_points(d->dev);
+	for (int i = 0; aps && i < aps->len; i++)
+		scan_entry_add(d, g_ptr_array_index(aps, i));
+
+	g_signal_connect(d->dev, "access-point-added", G_CALLBACK(ap_added), d);
+	g_signal_connect(d->dev, "access-point-removed", G_CALLBACK(ap_removed), d);
+
+	return (libnm_wrapper_scan_delta) d;
+}
+
+/**
+ * Get the APs added, removed or whose strength changed since a generation.
+ * @param delta: delta tracker
+ * @param generation: generation the caller is at, updated on return
+ * @param changes: location to store changes
+ * @param size: size of changes
+ *
+ * Returns: number of changes stored, -1 if the generation is too old
+ */
+int libnm_wrapper_scan_delta_get(libnm_wrapper_scan_delta delta, unsigned long long *generation,
+	NMWrapperAccessPointDelta *changes, int size)
+{
+	int num = 0;
+	GList *l;
+	scan_entry_st *e;
+	libnm_wrapper_scan_delta_st *d = (libnm_wrapper_scan_delta_st *)delta;
+	guint64 since;
+
+	nm_wrapper_assert(d, -1)
+	nm_wrapper_assert(generation, -1)
+
+	since = *generation;
+	if (since && since < d->floor)
+		return -1;
+
+	// Walk back to the first change after the caller's generation
+	for (l = d->changes.tail; l && ((scan_entry_st *)l->data)->changed_gen > since; l = l->prev)
+		;
+	l = l ? l->next : d->changes.head;
+
+	for (; l && num < size; l = l->next)
+	{
+		e = (scan_entry_st *)l->data;
+		*generation = e->changed_gen;
+
+		// Never seen by the caller, nothing to report
+		if (e->removed && e->added_gen > since)
+			continue;
+
+		changes[num] = e->info;
+		if (e->removed)
+			changes[num].change = LIBNM_WRAPPER_AP_REMOVED;
+		else if (e->added_gen > since)
+			changes[num].change = LIBNM_WRAPPER_AP_ADDED;
+		else
+			changes[num].change = LIBNM_WRAPPER_AP_CHANGED;
+		num++;
+	}
+
+	return num;
+}
+
+/**
+ * Request a scan and wait for its results asynchronously.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param ssids: SSIDs to probe for, NULL for a broadcast probe
+ * @param num_ssids: number of ssids
+ * @param frequency_list: frequencies to scan, same format as
+ *                        NMWrapperWirelessSettings.frequency_list, NULL or
+ *                        empty for all. Pruned to the regulatory domain
+ *                        and the radio of interface when the domain is
+ *                        followed
+ * @param context: main context to invoke callback on, NULL for the handle's one
+ * @param callback: called once the AP list is updated
+ * @param user_data: user data passed to callback
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if the scan was requested,
+ *          LIBNM_WRAPPER_ERR_NOT_IMPLEMENTED if frequency_list is given and
+ *          NetworkManager does not support restricting frequencies
+ */
+int libnm_wrapper_access_point_scan_async(libnm_wrapper_handle hd, const char *interface,
+	const char **ssids, int num_ssids, const char *frequency_list,
+	GMainContext *context, LIBNM_WRAPPER_ASYNC_CALLBACK callback, void *user_data)
+{
+	int num_freqs;
+	char *pruned;
+	GVariantBuilder options, list;
+	scan_request_st *r;
+	NMClient *client = ((libnm_wrapper_handle_st *)hd)->client;
+	NMDevice *dev = nm_client_get_device_by_iface(client, interface);
+
+	if (!dev || !NM_IS_DEVICE_WIFI(dev))
+		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+#ifndef LIBNM_WRAPPER_SCAN_FREQUENCIES
+	// Upstream NetworkManager ignores the "frequencies" option, don't let a
+	// restricted scan silently turn into a full one
+	if (frequency_list && *frequency_list)
+		return LIBNM_WRAPPER_ERR_NOT_IMPLEMENTED;
+#endif
+
+	g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+
+	if (ssids && num_ssids > 0)
+	{
+		g_variant_builder_init(&list, G_VARIANT_TYPE("aay"));
+		for (int i = 0; i < num_ssids; i++)
+			g_variant_builder_add_value(&list, g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
+				ssids[i], strnlen(ssids[i], LIBNM_WRAPPER_MAX_SSID_LEN), 1));
+		g_variant_builder_add(&options, "{sv}", "ssids", g_variant_builder_end(&list));
+	}
+
+	// Only scan channels the regulatory domain allows and the radio can use,
+	// if the domain is followed
+	pruned = nm_wrapper_reg_prune_frequency_list(hd, interface, frequency_list);
+	g_variant_builder_init(&list, G_VARIANT_TYPE("au"));
+	if (!pruned || !parse_frequency_list(pruned, &list, &num_freqs) ||
+		(!num_freqs && frequency_list && *frequency_list))
+	{
+		g_free(pruned);
+		g_variant_builder_clear(&list);
+		g_variant_builder_clear(&options);
+		return LIBNM_WRAPPER_ERR_INVALID_PARAMETER;
+	}
+	g_free(pruned);
+	if (num_freqs)
+		g_variant_builder_add(&options, "{sv}", "frequencies", g_variant_builder_end(&list));
+	else
+		g_variant_builder_clear(&list);
+
+	r = g_malloc0(sizeof(scan_request_st));
+	r->dev = g_object_ref(NM_DEVICE_WIFI(dev));
+	r->last_scan = nm_device_wifi_get_last_scan(r->dev);
+	r->context = g_main_context_ref(handle_context(hd, context));
+	r->callback = callback;
+	r->user_data = user_data;
+	r->ref = 2;
+
+	// Property notifications are emitted on the client's context
+	r->handler = g_signal_connect(r->dev, "notify::" NM_DEVICE_WIFI_LAST_SCAN,
+		G_CALLBACK(scan_last_scan_changed), r);
+	r->deadline = g_timeout_source_new(SCAN_TIMEOUT_MS);
+	g_source_set_callback(r->deadline, scan_deadline, r, NULL);
+	g_source_attach(r->deadline, handle_context(hd, NULL));
+
+	context_push(handle_context(hd, NULL));
+	nm_device_wifi_request_scan_options_async(r->dev, g_variant_builder_end(&options),
+		NULL, scan_requested_cb, r);
+	context_pop(handle_context(hd, NULL));
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+
+/**
+ * Request a scan and wait for its results.
+ * @param hd: library handle
+ * @param interface: on which interface
+ * @param ssids: SSIDs to probe for, NULL for a broadcast probe
+ * @param num_ssids: number of ssids
+ * @param frequency_list: frequencies to scan, NULL or empty for all
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful
+ */
+int libnm_wrapper_access_point_scan(libnm_wrapper_handle hd, const char *interface,
+	const char **ssids, int num_ssids, const char *frequency_list)
+{
+	libnm_wrapper_sync_st sync;
+
+	sync_init(&sync, handle_context(hd, NULL));
+	return sync_wait(&sync, libnm_wrapper_access_point_scan_async(hd, interface,
+		ssids, num_ssids, frequency_list, NULL, sync_done_cb, &sync));
+}
+
+/**
+ * Stop tracking changes and release the tracker.
+ * @param delta: delta tracker
+ */
+void libnm_wrapper_scan_delta_free(libnm_wrapper_scan_delta delta)
+{
+	GList *l;
+	libnm_wrapper_scan_delta_st *d = (libnm_wrapper_scan_delta_st *)delta;
+
+	if (!d)
+		return;
+
+	g_signal_handlers_disconnect_by_data(d->dev, d);
+	while ((l = g_queue_pop_head_link(&d->changes)))
+		scan_entry_free((scan_entry_st *)l->data);
+	g_hash_table_unref(d->aps);
+	g_object_unref(d->dev);
+	g_free(d);
+}
+/**@}*/
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2019, Laird
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+#include <glib-unix.h>
+#include "nl80211_wiphy.h"
+#include "libnm_wrapper_internal.h"
+
+/**
+ * Radio capabilities.
+ * The capabilities of every radio are kept in the nl80211_wiphy_cache of
+ * the netlink examples, built on first use. Its notification socket is
+ * attached to the main context of the handle, so the table follows
+ * regulatory changes and radios coming and going.
+ */
+
+G_STATIC_ASSERT(LIBNM_WRAPPER_CHAN_DISABLED == NL80211_WIPHY_CHAN_DISABLED);
+G_STATIC_ASSERT(LIBNM_WRAPPER_CHAN_INDOOR_ONLY == NL80211_WIPHY_CHAN_INDOOR_ONLY);
+
+struct _nm_wrapper_wiphy_st
+{
+	// Requests of the cache and interface lookups
+	struct nl80211_state req;
+	struct nl80211_wiphy_cache cache;
+	GSource *source;
+};
+
+static gboolean wiphy_readable(gint fd, GIOCondition condition, gpointer user_data)
+{
+	nm_wrapper_wiphy_st *w = (nm_wrapper_wiphy_st *)user_data;
+
+	nl80211_wiphy_cache_dispatch(&w->cache);
+	return G_SOURCE_CONTINUE;
+}
+
+void nm_wrapper_wiphy_free(nm_wrapper_wiphy_st *w)
+{
+	if (!w)
+		return;
+
+	if (w->source)
+	{
+		g_source_destroy(w->source);
+		g_source_unref(w->source);
+	}
+	nl80211_wiphy_cache_free(&w->cache);
+	nl80211_cleanup(&w->req);
+	g_free(w);
+}
+
+static nm_wrapper_wiphy_st *wiphy_get(libnm_wrapper_handle_st *st)
+{
+	nm_wrapper_wiphy_st *w;
+
+	if (st->wiphy)
+		return st->wiphy;
+
+	w = g_malloc0(sizeof(nm_wrapper_wiphy_st));
+	if (nl80211_init(&w->req) || nl80211_wiphy_cache_init(&w->cache, &w->req))
+	{
+		nm_wrapper_wiphy_free(w);
+		return NULL;
+	}
+
+	w->source = g_unix_fd_source_new(nl80211_wiphy_cache_get_fd(&w->cache), G_IO_IN);
+	g_source_set_callback(w->source, (GSourceFunc)wiphy_readable, w, NULL);
+	g_source_attach(w->source, st->context);
+
+	st->wiphy = w;
+	return w;
+}
+
+/**
+ * Capability table of every radio, built on first use, NULL if it cannot be
+ * read. Pending notifications are processed first, so the table reflects the
+ * current regulatory domain. Pointers into the table are valid until the
+ * context of the handle is iterated again.
+ */
+const struct nl80211_wiphy_cache *nm_wrapper_wiphy_sync(libnm_wrapper_handle hd)
+{
+	nm_wrapper_wiphy_st *w = wiphy_get((libnm_wrapper_handle_st *)hd);
+
+	if (!w)
+		return NULL;
+
+	nl80211_wiphy_cache_dispatch(&w->cache);
+	return &w->cache;
+}
+
+/**
+ * Index of the radio of an interface, -1 if the interface is not a wifi
+ * interface. Costs a request, callers resolving many profiles should only
+ * resolve each interface once.
+ */
+int nm_wrapper_wiphy_index(libnm_wrapper_handle hd, const char *interface)
+{
+	nm_wrapper_wiphy_st *w = wiphy_get((libnm_wrapper_handle_st *)hd);
+	int ifindex = interface ? if_nametoindex(interface) : 0;
+	int index;
+
+	if (!w || !ifindex)
+		return -1;
+
+	index = nl80211_wiphy_of_iface(&w->req, ifindex);
+	return index < 0 ? -1 : index;
+}
+
+/**
+ * Capabilities of the radio of an interface, NULL if the interface is not a
+ * wifi interface or the capabilities cannot be read. Valid as long as the
+ * table of nm_wrapper_wiphy_sync().
+ */
+const struct nl80211_wiphy_caps *nm_wrapper_wiphy_lookup(libnm_wrapper_handle hd, const char *interface)
+{
+	const struct nl80211_wiphy_cache *cache = nm_wrapper_wiphy_sync(hd);
+	int index = nm_wrapper_wiphy_index(hd, interface);
+
+	if (!cache || index < 0)
+		return NULL;
+
+	return nl80211_wiphy_cache_get(cache, index);
+}
+
+/**
+ * @name Radio Capability API
+ */
+/**@{*/
+/**
+ * Get the capabilities of the radio of an interface.
+ * @param hd: library handle
+ * @param interface: wifi interface name
+ * @param wiphy: location to store the capabilities
+ *
+ * Returns: LIBNM_WRAPPER_ERR_SUCCESS if successful,
+ *          LIBNM_WRAPPER_ERR_NO_HARDWARE if interface is not a wifi interface
+ */
+int libnm_wrapper_wiphy_get(libnm_wrapper_handle hd, const char *interface, NMWrapperWiphy *wiphy)
+{
+	const struct nl80211_wiphy_caps *caps;
+	const struct nl80211_wiphy_channel *ch;
+
+	nm_wrapper_assert(hd, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(interface, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+	nm_wrapper_assert(wiphy, LIBNM_WRAPPER_ERR_INVALID_PARAMETER)
+
+	caps = nm_wrapper_wiphy_lookup(hd, interface);
+	if (!caps)
+		return LIBNM_WRAPPER_ERR_NO_HARDWARE;
+
+	memset(wiphy, 0, sizeof(NMWrapperWiphy));
+	wiphy->index = caps->wiphy;
+	safe_strncpy(wiphy->name, caps->name, LIBNM_WRAPPER_MAX_NAME_LEN);
+
+	for (int i = 0; i < LIBNM_WRAPPER_MAX_BANDS && i < NUM_NL80211_BANDS; i++)
+	{
+		wiphy->bands[i].present = caps->bands[i].present;
+		wiphy->bands[i].ht = caps->bands[i].has_ht;
+		wiphy->bands[i].vht = caps->bands[i].has_vht;
+		wiphy->bands[i].he = caps->bands[i].has_he;
+		wiphy->bands[i].ht_capa = caps->bands[i].ht_capa;
+		wiphy->bands[i].vht_capa = caps->bands[i].vht_capa;
+	}
+
+	for (int i = 0; i < caps->n_channels && i < LIBNM_WRAPPER_MAX_WIPHY_CHANNELS; i++)
+	{
+		ch = &caps->channels[i];
+		wiphy->channels[i].freq = ch->freq;
+		// Same bits as the NL80211_WIPHY_CHAN_* flags
+		wiphy->channels[i].flags = ch->flags;
+		wiphy->channels[i].band = ch->band;
+		wiphy->channels[i].dfs_state = ch->dfs_state;
+		wiphy->channels[i].max_power = ch->max_power;
+		wiphy->num_channels++;
+	}
+
+	return LIBNM_WRAPPER_ERR_SUCCESS;
+}
+/**@}*/